@@ -0,0 +1,702 @@
+/////////////////////////////////////////////////////////////////////////////////
+//
+// CNRoom - Chats Noirs Room
+// Copyright (c) 2019 Fatih (accfldekur@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+//CNRoom
+#include "CNRoom/Room.hpp"
+
+//Standard
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+////////////////////////////////////////////////////////////
+/// \brief Settings of a run, read from the command line
+///
+////////////////////////////////////////////////////////////
+struct Settings
+{
+    std::vector<std::size_t>    sizes{1000, 100000, 1000000};   ///< Number of keys of the drawers
+    double                      time = 0.5;                     ///< Seconds spent on each measure
+    std::size_t                 operations = 100000;            ///< Maximum number of operations of each measure
+    std::filesystem::path       directory = std::filesystem::temp_directory_path() / "cnroom-benchmark"; ///< Directory of the drawers
+    std::filesystem::path       output = "benchmark.json";      ///< Path to the results
+    std::string                 label;                          ///< Label of the run, like a commit
+};
+
+////////////////////////////////////////////////////////////
+/// \brief Result of a measure
+///
+////////////////////////////////////////////////////////////
+struct Result
+{
+    std::size_t                 keys;       ///< Number of keys of the drawer
+    std::string                 encoding;   ///< Encoding of the drawer
+    std::string                 mode;       ///< Mode of the stream, empty for reads
+    std::string                 durability; ///< Durability of the room, empty without a room
+    std::string                 operation;  ///< Measured operation
+    std::size_t                 count;      ///< Number of operations
+    double                      seconds;    ///< Time spent in the operations
+    double                      p50;        ///< Median latency in microseconds
+    double                      p99;        ///< 99th percentile latency in microseconds
+};
+
+////////////////////////////////////////////////////////////
+/// \brief Get the name of a key
+///
+/// \param index Index of the key
+///
+/// \return Name
+///
+////////////////////////////////////////////////////////////
+std::string name(std::size_t index)
+{
+    return "user:" + std::to_string(index) + ":profile";
+}
+
+////////////////////////////////////////////////////////////
+/// \brief Get a key with one value of each type
+///
+/// \param index Index of the key
+/// \param generation Number changing the values
+///
+/// \return Key
+///
+////////////////////////////////////////////////////////////
+CNRoom::Key key(std::size_t index, std::size_t generation = 0)
+{
+    int number = static_cast<int>(index + generation);
+
+    return CNRoom::Key{name(index), {"mail" + std::to_string(number) + "@example.com", number, number * 0.25, number % 2 == 0}};
+}
+
+////////////////////////////////////////////////////////////
+/// \brief Write a drawer with a number of keys in one pass
+///
+/// \param file Path to the drawer
+/// \param keys Number of keys
+/// \param encoding Encoding of the drawer
+///
+////////////////////////////////////////////////////////////
+void generate(const std::filesystem::path& file, std::size_t keys, CNRoom::Encoding encoding)
+{
+    std::filesystem::remove(file);
+
+    CNRoom::Stream stream(file, true);
+    stream.convert(encoding);
+
+    CNRoom::WriteBatch batch;
+
+    for(std::size_t i = 0; i < keys; ++i)
+    {
+        batch.write(key(i));
+    }
+
+    stream.apply(batch);
+}
+
+////////////////////////////////////////////////////////////
+/// \brief Run an operation until the time or the number of
+/// operations of the settings is reached
+///
+/// \param settings Settings of the run
+/// \param operation Function running the operation once, with
+/// the number of the operation
+/// \param result Result to fill
+///
+////////////////////////////////////////////////////////////
+void measure(const Settings& settings, const std::function<void(std::size_t)>& operation, Result& result)
+{
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<double> latencies;
+
+    Clock::time_point start = Clock::now();
+    double elapsed = 0;
+
+    while(latencies.size() < settings.operations && (elapsed < settings.time || latencies.size() < 3))
+    {
+        Clock::time_point before = Clock::now();
+
+        operation(latencies.size());
+
+        Clock::time_point after = Clock::now();
+
+        latencies.push_back(std::chrono::duration<double, std::micro>(after - before).count());
+
+        elapsed = std::chrono::duration<double>(after - start).count();
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+
+    result.count = latencies.size();
+    result.seconds = 0;
+
+    for(double it: latencies)
+    {
+        result.seconds += it / 1e6;
+    }
+
+    result.p50 = latencies[latencies.size() / 2];
+    result.p99 = latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)];
+}
+
+////////////////////////////////////////////////////////////
+/// \brief Run an operation on several threads at once until
+/// the time or the number of operations of the settings is
+/// reached, the throughput is measured over the wall time
+///
+/// \param settings Settings of the run
+/// \param threads Number of threads
+/// \param operation Function running the operation once, with
+/// the number of the thread and of the operation
+/// \param result Result to fill
+///
+////////////////////////////////////////////////////////////
+void measure(const Settings& settings, std::size_t threads, const std::function<void(std::size_t, std::size_t)>& operation, Result& result)
+{
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<std::vector<double>> latencies(threads);
+    std::atomic<std::size_t> started(0);
+
+    Clock::time_point start = Clock::now();
+
+    std::vector<std::thread> workers;
+
+    for(std::size_t thread = 0; thread < threads; ++thread)
+    {
+        workers.emplace_back([&, thread]()
+        {
+            bool done = false;
+
+            while(!done)
+            {
+                std::size_t i = started++;
+
+                done = i >= settings.operations || (std::chrono::duration<double>(Clock::now() - start).count() >= settings.time && i >= 3 * threads);
+
+                if(!done)
+                {
+                    Clock::time_point before = Clock::now();
+
+                    operation(thread, i);
+
+                    latencies[thread].push_back(std::chrono::duration<double, std::micro>(Clock::now() - before).count());
+                }
+            }
+        });
+    }
+
+    for(auto& it: workers)
+    {
+        it.join();
+    }
+
+    std::vector<double> merged;
+
+    for(const auto& it: latencies)
+    {
+        merged.insert(merged.end(), it.begin(), it.end());
+    }
+
+    std::sort(merged.begin(), merged.end());
+
+    result.count = merged.size();
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    result.p50 = merged[merged.size() / 2];
+    result.p99 = merged[std::min(merged.size() - 1, merged.size() * 99 / 100)];
+}
+
+////////////////////////////////////////////////////////////
+/// \brief Print a result and keep it
+///
+/// \param result Result
+/// \param results Results of the run
+///
+////////////////////////////////////////////////////////////
+void report(const Result& result, std::vector<Result>& results)
+{
+    std::printf("%8zu  %-10s  %-7s  %-5s  %-17s  %12.0f ops/s  p50 %10.1f us  p99 %10.1f us\n", result.keys, result.encoding.c_str(), result.mode.empty() ? "-" : result.mode.c_str(), result.durability.empty() ? "-" : result.durability.c_str(), result.operation.c_str(), result.count / result.seconds, result.p50, result.p99);
+    std::fflush(stdout);
+
+    results.push_back(result);
+}
+
+////////////////////////////////////////////////////////////
+/// \brief Quote a string for JSON
+///
+/// \param text String
+///
+/// \return Quoted string
+///
+////////////////////////////////////////////////////////////
+std::string quote(const std::string& text)
+{
+    std::string quoted = "\"";
+
+    for(char it: text)
+    {
+        if(it == '"' || it == '\\')
+        {
+            quoted += '\\';
+        }
+
+        quoted += it;
+    }
+
+    return quoted + '"';
+}
+
+////////////////////////////////////////////////////////////
+/// \brief Write the results as JSON
+///
+/// \param settings Settings of the run
+/// \param results Results of the run
+///
+////////////////////////////////////////////////////////////
+void save(const Settings& settings, const std::vector<Result>& results)
+{
+    std::ofstream writer(settings.output);
+
+    writer << "{\n  \"label\": " << quote(settings.label) << ",\n  \"results\": [\n";
+
+    for(std::size_t i = 0; i < results.size(); ++i)
+    {
+        const Result& it = results[i];
+
+        writer << "    {\"keys\": " << it.keys
+               << ", \"encoding\": " << quote(it.encoding)
+               << ", \"mode\": " << (it.mode.empty() ? "null" : quote(it.mode))
+               << ", \"durability\": " << (it.durability.empty() ? "null" : quote(it.durability))
+               << ", \"operation\": " << quote(it.operation)
+               << ", \"operations\": " << it.count
+               << ", \"ops_per_second\": " << it.count / it.seconds
+               << ", \"p50_us\": " << it.p50
+               << ", \"p99_us\": " << it.p99 << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+
+    writer << "  ]\n}\n";
+
+    if(!writer)
+    {
+        throw std::runtime_error("Failed to write results on \"" + settings.output.string() + "\"");
+    }
+}
+
+////////////////////////////////////////////////////////////
+/// \brief Read the settings from the command line
+///
+/// \param argc Number of arguments
+/// \param argv Arguments
+///
+/// \return Settings, nothing if the usage was asked
+///
+////////////////////////////////////////////////////////////
+std::optional<Settings> parse(int argc, char** argv)
+{
+    Settings settings;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string argument = argv[i];
+        std::string value = argument.substr(argument.find('=') == std::string::npos ? argument.size() : argument.find('=') + 1);
+
+        if(argument.compare(0, 8, "--sizes=") == 0)
+        {
+            settings.sizes.clear();
+
+            std::stringstream list(value);
+            std::string size;
+
+            while(std::getline(list, size, ','))
+            {
+                settings.sizes.push_back(std::stoul(size));
+            }
+        }
+        else if(argument.compare(0, 7, "--time=") == 0)
+        {
+            settings.time = std::stod(value);
+        }
+        else if(argument.compare(0, 13, "--operations=") == 0)
+        {
+            settings.operations = std::stoul(value);
+        }
+        else if(argument.compare(0, 12, "--directory=") == 0)
+        {
+            settings.directory = value;
+        }
+        else if(argument.compare(0, 9, "--output=") == 0)
+        {
+            settings.output = value;
+        }
+        else if(argument.compare(0, 8, "--label=") == 0)
+        {
+            settings.label = value;
+        }
+        else
+        {
+            std::cout << "Usage: cnroom_benchmark [--sizes=1000,100000,1000000] [--time=0.5] [--operations=100000]" << std::endl;
+            std::cout << "                        [--directory=path] [--output=benchmark.json] [--label=commit]" << std::endl;
+
+            return std::nullopt;
+        }
+    }
+
+    return settings;
+}
+}
+
+int main(int argc, char** argv)
+{
+    std::optional<Settings> settings = parse(argc, argv);
+
+    if(!settings)
+    {
+        return 1;
+    }
+
+    std::filesystem::remove_all(settings->directory);
+    std::filesystem::create_directories(settings->directory);
+
+    std::filesystem::path base = settings->directory / "base.hkn";
+    std::filesystem::path file = settings->directory / "drawer.hkn";
+
+    std::vector<Result> results;
+
+    std::mt19937_64 random(42);
+
+    const std::pair<CNRoom::Encoding, std::string> encodings[] = {{CNRoom::Encoding::Text, "text"}, {CNRoom::Encoding::Binary, "binary"}, {CNRoom::Encoding::Compressed, "compressed"}};
+    const std::pair<CNRoom::Stream::Mode, std::string> modes[] = {{CNRoom::Stream::Mode::Rewrite, "rewrite"}, {CNRoom::Stream::Mode::Append, "append"}};
+    const std::pair<CNRoom::Durability, std::string> durabilities[] = {{CNRoom::Durability::None, "none"}, {CNRoom::Durability::Batch, "batch"}, {CNRoom::Durability::Write, "write"}};
+
+    for(std::size_t keys: settings->sizes)
+    {
+        std::uniform_int_distribution<std::size_t> pick(0, keys - 1);
+
+        for(const auto& encoding: encodings)
+        {
+            generate(base, keys, encoding.first);
+
+            auto reset = [&]()
+            {
+                std::filesystem::remove(file);
+                std::filesystem::remove(settings->directory / ".cnroom" / (file.filename().string() + ".idx"));
+                std::filesystem::remove(settings->directory / ".cnroom" / (file.filename().string() + ".blb"));
+
+                std::filesystem::copy_file(base, file);
+            };
+
+            Result result{keys, encoding.second, "", "", "", 0, 0, 0, 0};
+
+            reset();
+
+            if(encoding.first == CNRoom::Encoding::Text)
+            {
+                std::ifstream reader(base, std::ios_base::binary);
+                std::string content((std::istreambuf_iterator<char>(reader)), std::istreambuf_iterator<char>());
+
+                std::size_t position = CNRoom::Codec::origin(encoding.first);
+
+                result.operation = "text_parse";
+                measure(*settings, [&](std::size_t)
+                {
+                    CNRoom::Codec::Record record;
+
+                    if(!CNRoom::Codec::next(content, position, encoding.first, record))
+                    {
+                        position = CNRoom::Codec::origin(encoding.first);
+
+                        CNRoom::Codec::next(content, position, encoding.first, record);
+                    }
+
+                    CNRoom::Key parsed{std::string(record.name), {}};
+                    CNRoom::Codec::parse(record.values, encoding.first, parsed);
+
+                    position += record.size;
+                }, result);
+                report(result, results);
+            }
+
+            {
+                CNRoom::Stream stream(file);
+
+                result.operation = "point_read";
+                measure(*settings, [&](std::size_t)
+                {
+                    stream.read(name(pick(random)));
+                }, result);
+                report(result, results);
+
+                result.operation = "point_read_arena";
+                measure(*settings, [&](std::size_t)
+                {
+                    CNRoom::pmr::Arena<512> arena;
+
+                    stream.read(name(pick(random)), &arena);
+                }, result);
+                report(result, results);
+
+                CNRoom::TypedStream<std::string, int, double, bool> typed(stream);
+
+                result.operation = "point_read_typed";
+                measure(*settings, [&](std::size_t)
+                {
+                    typed.read(name(pick(random)));
+                }, result);
+                report(result, results);
+
+                std::vector<std::string> names(32);
+
+                result.operation = "read_many_32";
+                measure(*settings, [&](std::size_t)
+                {
+                    for(auto& it: names)
+                    {
+                        it = name(pick(random));
+                    }
+
+                    stream.read_many(names);
+                }, result);
+                report(result, results);
+
+                result.operation = "full_scan";
+                measure(*settings, [&](std::size_t)
+                {
+                    std::size_t count = 0;
+
+                    stream.for_each([&count](const CNRoom::Key&)
+                    {
+                        return ++count > 0;
+                    });
+                }, result);
+                report(result, results);
+
+                stream.add_index(0, CNRoom::Stream::Lookup::Hash);
+
+                result.operation = "find_by_hash";
+                measure(*settings, [&](std::size_t)
+                {
+                    stream.find_by(0, "mail" + std::to_string(pick(random)) + "@example.com");
+                }, result);
+                report(result, results);
+
+                stream.add_index(1, CNRoom::Stream::Lookup::Ordered);
+
+                result.operation = "find_by_range_32";
+                measure(*settings, [&](std::size_t)
+                {
+                    double low = static_cast<double>(pick(random));
+
+                    stream.find_by(1, low, low + 31);
+                }, result);
+                report(result, results);
+
+                stream.drop_index(0);
+                stream.drop_index(1);
+            }
+
+            {
+                CNRoom::Room room;
+                room.connect(settings->directory);
+                room.quick_read(file.filename(), name(0));
+
+                result.operation = "quick_read";
+                measure(*settings, [&](std::size_t)
+                {
+                    room.quick_read(file.filename(), name(pick(random)));
+                }, result);
+                report(result, results);
+
+                room.set_cache_size(std::size_t(64) << 20);
+
+                result.operation = "quick_read_cached";
+                measure(*settings, [&](std::size_t)
+                {
+                    room.quick_read(file.filename(), name(pick(random)));
+                }, result);
+                report(result, results);
+            }
+
+            {
+                const std::size_t concurrency = std::max(4u, std::thread::hardware_concurrency());
+
+                CNRoom::Room room;
+                room.connect(settings->directory);
+                room.set_mode(CNRoom::Stream::Mode::Append);
+
+                std::vector<std::filesystem::path> copies;
+                std::vector<std::mt19937_64> randoms;
+
+                for(std::size_t threads = 1; threads <= concurrency; threads *= 2)
+                {
+                    while(copies.size() < threads)
+                    {
+                        copies.push_back("thread" + std::to_string(copies.size()) + ".hkn");
+                        randoms.emplace_back(random());
+
+                        std::filesystem::copy_file(base, settings->directory / copies.back(), std::filesystem::copy_options::overwrite_existing);
+                    }
+
+                    result.operation = "quick_read_x" + std::to_string(threads);
+                    measure(*settings, threads, [&](std::size_t thread, std::size_t)
+                    {
+                        room.quick_read(file.filename(), name(std::uniform_int_distribution<std::size_t>(0, keys - 1)(randoms[thread])));
+                    }, result);
+                    report(result, results);
+
+                    result.mode = "append";
+                    result.operation = "quick_write_x" + std::to_string(threads);
+                    measure(*settings, threads, [&](std::size_t thread, std::size_t i)
+                    {
+                        room.quick_write(copies[thread], key(std::uniform_int_distribution<std::size_t>(0, keys - 1)(randoms[thread]), i + 1));
+                    }, result);
+                    report(result, results);
+
+                    result.mode.clear();
+                }
+
+                room.flush();
+
+                for(const auto& it: copies)
+                {
+                    std::filesystem::remove(settings->directory / it);
+                }
+            }
+
+            for(const auto& mode: modes)
+            {
+                result.mode = mode.second;
+
+                reset();
+
+                {
+                    CNRoom::Stream stream(file, false, mode.first);
+
+                    result.operation = "overwrite";
+                    measure(*settings, [&](std::size_t i)
+                    {
+                        stream.write(key(pick(random), i + 1));
+                    }, result);
+                    report(result, results);
+
+                    result.operation = "insert";
+                    measure(*settings, [&](std::size_t i)
+                    {
+                        stream.write(key(keys + i));
+                    }, result);
+                    report(result, results);
+
+                    result.operation = "increment";
+                    measure(*settings, [&](std::size_t)
+                    {
+                        stream.increment(name(pick(random)), 1, 1);
+                    }, result);
+                    report(result, results);
+
+                    std::string document(4096, '{');
+
+                    stream.set_blob_threshold(1024);
+
+                    result.operation = "overwrite_blob_4k";
+                    measure(*settings, [&](std::size_t i)
+                    {
+                        CNRoom::Key written = key(pick(random), i + 1);
+                        written.values[0] = document + std::to_string(i);
+
+                        stream.write(written);
+                    }, result);
+                    report(result, results);
+                }
+
+                reset();
+
+                {
+                    CNRoom::Stream stream(file, false, mode.first);
+
+                    std::vector<std::size_t> order(keys);
+
+                    for(std::size_t i = 0; i < keys; ++i)
+                    {
+                        order[i] = i;
+                    }
+
+                    std::shuffle(order.begin(), order.end(), random);
+
+                    result.operation = "remove";
+                    measure(*settings, [&](std::size_t i)
+                    {
+                        stream.remove(name(order[i % keys]));
+                    }, result);
+                    report(result, results);
+                }
+
+                for(const auto& durability: durabilities)
+                {
+                    reset();
+
+                    CNRoom::Room room;
+                    room.connect(settings->directory);
+                    room.set_mode(mode.first);
+                    room.set_durability(durability.first);
+                    room.quick_read(file.filename(), name(0));
+
+                    result.durability = durability.second;
+                    result.operation = "quick_write";
+                    measure(*settings, [&](std::size_t i)
+                    {
+                        room.quick_write(file.filename(), key(pick(random), i + 1));
+                    }, result);
+                    report(result, results);
+                }
+
+                result.durability.clear();
+            }
+
+            result.mode.clear();
+        }
+    }
+
+    std::filesystem::remove_all(settings->directory);
+
+    save(*settings, results);
+
+    return 0;
+}
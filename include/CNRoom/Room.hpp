@@ -30,13 +30,63 @@
 // Headers
 ////////////////////////////////////////////////////////////
 //Standard
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
 #include <exception>
 #include <filesystem>
 #include <functional>
+#include <future>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 #include <variant>
 #include <fstream>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+
+#if defined(__cpp_impl_coroutine)
+    #include <coroutine>
+#endif
+
+//System
+#if defined(__unix__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <sys/file.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+////////////////////////////////////////////////////////////
+// Configuration
+////////////////////////////////////////////////////////////
+#ifndef CNROOM_STATISTICS
+    #define CNROOM_STATISTICS 0
+#endif
 
 namespace CNRoom
 {
@@ -77,6 +127,10 @@ public:
         {
             std::variant<Type, Types ...>::operator=(std::string(character));
         }
+        else if constexpr(!contains<const char*, Type, Types...>() && contains<std::pmr::string, Type, Types...>())
+        {
+            std::variant<Type, Types ...>::operator=(std::pmr::string(character));
+        }
         else
         {
             std::variant<Type, Types ...>::operator=(character);
@@ -96,20 +150,24 @@ public:
     }
 
     ///////////////////////////////////////////////////////////
-    /// \brief Convert to the standard variant
+    /// \brief Get the standard variant, to visit it without a
+    /// copy
     ///
-    /// \return Standard variant
+    /// \return Standard variant, the same object
     ///
     ////////////////////////////////////////////////////////////
-    std::variant<Type, Types ...> standard() const
+    const std::variant<Type, Types ...>& standard() const
     {
-        return std::variant<Type, Types ...>(*this);
+        return *this;
     }
 };
 
 ////////////////////////////////////////////////////////////
 using Types = Variant<std::string, int, double, bool>; ///< Value types
 
+////////////////////////////////////////////////////////////
+using Views = Variant<std::string_view, int, double, bool>; ///< Value types viewing a drawer
+
 ////////////////////////////////////////////////////////////
 /// \brief Struct that represents a key
 ///
@@ -168,505 +226,10820 @@ struct Key
     }
 };
 
+namespace pmr
+{
+
 ////////////////////////////////////////////////////////////
-/// \brief Stream class to operate files
+using Types = Variant<std::pmr::string, int, double, bool>; ///< Value types allocating from a memory resource
+
+////////////////////////////////////////////////////////////
+/// \brief Key allocating its name, values and strings from a
+/// memory resource, like a request-scoped arena
+///
+/// Copies keep the memory resource given to them, or the
+/// default one.
 ///
 ////////////////////////////////////////////////////////////
-class Stream
+struct Key
 {
-public:
+    using allocator_type = std::pmr::polymorphic_allocator<char>; ///< Allocator, makes containers of keys pass theirs
+
     ////////////////////////////////////////////////////////////
-    /// \brief Construct an empty stream
+    /// \brief Construct an empty key
+    ///
+    /// \param allocator Allocator, the default memory resource by
+    /// default
     ///
     ////////////////////////////////////////////////////////////
-                Stream() : mFile("")
+                Key(allocator_type allocator = {}) : name(allocator), values(allocator)
     {
 
     }
 
     ////////////////////////////////////////////////////////////
-    /// \brief Construct a stream ready to be operate on
+    /// \brief Construct a key without values
     ///
-    /// \param file Path to the file to operate
-    /// \param create Create new if file doesn't exist, false by
+    /// \param name Name of the key
+    /// \param allocator Allocator, the default memory resource by
     /// default
     ///
     ////////////////////////////////////////////////////////////
-                Stream(const std::filesystem::path& file, bool create = false) : mFile(file)
+                Key(std::string_view name, allocator_type allocator = {}) : name(name, allocator), values(allocator)
     {
-        open(file, create);
+
     }
 
     ////////////////////////////////////////////////////////////
-    /// \brief Default destructor
+    /// \brief Copy a standard key
+    ///
+    /// \param key Key to copy
+    /// \param allocator Allocator, the default memory resource by
+    /// default
     ///
     ////////////////////////////////////////////////////////////
-                ~Stream()
+                Key(const CNRoom::Key& key, allocator_type allocator = {}) : name(key.name, allocator), values(allocator)
     {
-        if(mStream)
-        {
-            mStream.close();
-        }
+        assign(key.values);
     }
 
     ////////////////////////////////////////////////////////////
-    /// \brief Open a file to operate on
+    /// \brief Copy a key with another allocator
     ///
-    /// \param file Path to the file to operate
-    /// \param create Create new if file doesn't exist, false by
-    /// default
+    /// \param key Key to copy
+    /// \param allocator Allocator
     ///
     ////////////////////////////////////////////////////////////
-    void        open(const std::filesystem::path& file, bool create = false)
+                Key(const Key& key, allocator_type allocator) : name(key.name, allocator), values(allocator)
     {
-        bool exists = true;
-
-        mFile = file;
+        assign(key.values);
+    }
 
-        if(!std::filesystem::exists(file))
-        {
-            if(create)
-            {
-                std::ofstream writer(file);
+    ////////////////////////////////////////////////////////////
+    /// \brief Copy a key with the default memory resource
+    ///
+    /// \param key Key to copy
+    ///
+    ////////////////////////////////////////////////////////////
+                Key(const Key& key) : Key(key, allocator_type())
+    {
 
-                if(!writer && file.string().size() > file.filename().string().size())
-                {
-                    std::filesystem::create_directories(file.string().substr(0, file.string().size() - file.filename().string().size()));
-                    writer.open(file);
-                }
+    }
 
-                if(writer)
-                {
-                    writer.close();
-                }
-                else
-                {
-                    exists = false;
-                    throw std::runtime_error("Stream failed to create file on \"" + file.string() + "\"");
-                }
-            }
-            else
-            {
-                exists = false;
-                throw std::runtime_error("Path \"" + file.string() + "\" doesn't point to any file");
-            }
+    ////////////////////////////////////////////////////////////
+    /// \brief Move a key to another allocator, copying it if
+    /// the memory resources differ
+    ///
+    /// \param key Key to move
+    /// \param allocator Allocator
+    ///
+    ////////////////////////////////////////////////////////////
+                Key(Key&& key, allocator_type allocator) : name(std::move(key.name), allocator), values(allocator)
+    {
+        if(key.values.get_allocator() == allocator)
+        {
+            values = std::move(key.values);
+        }
+        else
+        {
+            assign(key.values);
         }
+    }
 
-        if(exists)
+                Key(Key&&) = default;
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Copy a key, keeping the allocator
+    ///
+    /// \param key Key to copy
+    ///
+    /// \return Key
+    ///
+    ////////////////////////////////////////////////////////////
+    Key&        operator =(const Key& key)
+    {
+        if(this != &key)
         {
-            mStream.open(file);
+            name = key.name;
 
-            if(!mStream)
-            {
-                throw std::runtime_error("Stream failed to open file on \"" + file.string() + "\"");
-            }
+            assign(key.values);
         }
+
+        return *this;
     }
 
-    ///////////////////////////////////////////////////////////
-    /// \brief Overload of operator << to write to the file
+    ////////////////////////////////////////////////////////////
+    /// \brief Move a key, keeping the allocator, copying the key
+    /// if the memory resources differ
+    ///
+    /// \param key Key to move
+    ///
+    /// \return Key
     ///
     ////////////////////////////////////////////////////////////
-    Stream&     operator <<(Key key)
+    Key&        operator =(Key&& key)
     {
-        write(key);
+        if(key.get_allocator() == get_allocator())
+        {
+            name = std::move(key.name);
+            values = std::move(key.values);
+        }
+        else
+        {
+            *this = key;
+        }
+
         return *this;
     }
 
-    ///////////////////////////////////////////////////////////
-    /// \brief Overload of operator >> to read from a file
+    ////////////////////////////////////////////////////////////
+    /// \brief Overload of operator [] to retrieve a value by index
+    ///
+    /// \param index Index of the value
+    ///
+    /// \return Value
     ///
     ////////////////////////////////////////////////////////////
-    Stream&     operator >>(const std::string& name)
+    Types&      operator [](std::size_t index)
     {
-        mKey = read(name);
-        return *this;
+        return values[index];
     }
 
-    ///////////////////////////////////////////////////////////
-    /// \brief Overload of operator () to access internal key
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the allocator of the key
     ///
-    /// \return Internal key
+    /// \return Allocator
     ///
     ////////////////////////////////////////////////////////////
-    Key&        operator ()()
+    allocator_type get_allocator() const
     {
-        return mKey;
+        return name.get_allocator();
     }
 
     ////////////////////////////////////////////////////////////
-    /// \brief Write a key to the stream
+    /// \brief Copy to a standard key
     ///
-    /// \param key Key to write
+    /// \return Key
     ///
     ////////////////////////////////////////////////////////////
-    void        write(const Key& key)
+    CNRoom::Key key() const
     {
-        if(mStream)
-        {
-            mStream.seekg(0, mStream.beg);
+        CNRoom::Key copy{std::string(name), {}};
 
-            std::vector<std::string> fields;
+        copy.values.reserve(values.size());
 
-            std::string field;
-            while(std::getline(mStream, field))
+        for(const auto& it: values)
+        {
+            std::visit([&copy](const auto& value)
             {
-                auto pos = field.find_first_of(':');
+                using Value = std::decay_t<decltype(value)>;
 
-                if(key.name != field.substr(0, pos))
+                if constexpr(std::is_same_v<Value, std::pmr::string>)
                 {
-                    fields.push_back(field);
+                    copy.values.emplace_back(std::in_place_type<std::string>, value);
                 }
-            }
-
-            mStream.close();
-
-            mStream.open(mFile, std::ios_base::in | std::ios_base::out | std::ios_base::trunc);
-
-            for(const auto& it: fields)
-            {
-                mStream << it << '\n';
-            }
-
-            mStream << key.name << ':';
-
-            for(size_t i = 0; i < key.values.size(); ++i)
-            {
-                std::holds_alternative<std::string>(key.values[i]) ? mStream << '\"' << Key::string(key.values[i]) << '\"' : mStream << Key::string(key.values[i]);
-
-                if(i != key.values.size() - 1)
+                else
                 {
-                    mStream << ',';
+                    copy.values.emplace_back(std::in_place_type<Value>, value);
                 }
-            }
-
-            mStream.clear();
-        }
-        else
-        {
-            throw std::runtime_error("Could not write, stream failed");
+            }, it.standard());
         }
+
+        return copy;
     }
 
     ////////////////////////////////////////////////////////////
-    /// \brief Read a key from the stream
+    /// \brief Convert a value to a value allocating its string
+    /// from an allocator
     ///
-    /// \param name Name of the key to read
+    /// \param value Value of Types, pmr::Types or Views
+    /// \param allocator Allocator
     ///
-    /// \return Key
+    /// \return Value
     ///
     ////////////////////////////////////////////////////////////
-    Key     read(const std::string& name)
+    template<typename Value>
+    static Types convert(const Value& value, allocator_type allocator)
     {
-        Key key{name, {}};
+        Types converted(std::in_place_type<int>, 0);
 
-        if(mStream)
+        std::visit([&converted, allocator](const auto& it)
         {
-            mStream.seekg(0, mStream.beg);
-
-            std::string field;
+            using Alternative = std::decay_t<decltype(it)>;
 
-            bool done = false;
-            while(std::getline(mStream, field) && !done)
+            if constexpr(std::is_same_v<Alternative, int> || std::is_same_v<Alternative, double> || std::is_same_v<Alternative, bool>)
             {
-                if(name == field.substr(0, field.find_first_of(':')))
-                {
-                    std::string values = field.substr(field.find_first_of(':') + 1);
-
-                    size_t last = 0;
-                    while(!done)
-                    {
-                        auto pos = values.find_first_of(',', last);
-
-                        std::string token = values.substr(last, pos - last);
-
-                        if(token.empty())
-                        {
-                            key.values.push_back(token);
-                        }
-                        else if(token == "true")
-                        {
-                            key.values.push_back(bool(true));
-                        }
-                        else if(token == "false")
-                        {
-                            key.values.push_back(bool(false));
-                        }
-                        else if(token.front() == '\"' && token.back() == '\"')
-                        {
-                            token.pop_back();
-                            token.erase(token.begin());
-
-                            key.values.push_back(token);
-                        }
-                        else if(token.find('.') != std::string::npos)
-                        {
-                            key.values.push_back(std::stod(token));
-                        }
-                        else
-                        {
-                            key.values.push_back(std::stoi(token));
-                        }
-
-                        if(pos != std::string::npos)
-                        {
-                            last = pos + 1;
-                        }
-                        else
-                        {
-                            done = true;
-                        }
-                    }
-                }
+                converted.template emplace<Alternative>(it);
             }
+            else
+            {
+                converted.template emplace<std::pmr::string>(std::string_view(it), allocator);
+            }
+        }, value.standard());
 
-            mStream.clear();
-        }
-        else
-        {
-            throw std::runtime_error("Could not read, stream failed");
-        }
-
-        return key;
+        return converted;
     }
 
     ////////////////////////////////////////////////////////////
-    /// \brief Remove a key in the stream
+    /// \brief Replace the values with copies allocated by the
+    /// allocator of the key
     ///
-    /// \param name Name of the key to delete
+    /// \param source Values to copy
     ///
     ////////////////////////////////////////////////////////////
-    void  remove(const std::string& name)
+    template<typename Values>
+    void        assign(const Values& source)
     {
-        if(mStream)
-        {
-            mStream.seekg(0, mStream.beg);
-
-            std::vector<std::string> fields;
-
-            std::string field;
-            while(std::getline(mStream, field))
-            {
-                auto pos = field.find_first_of(':');
-
-                if(name != field.substr(0, pos))
-                {
-                    fields.push_back(field);
-                }
-            }
-
-            mStream.close();
-
-            mStream.open(mFile, std::ios_base::in | std::ios_base::out | std::ios_base::trunc);
-
-            for(const auto& it: fields)
-            {
-                mStream << it << '\n';
-            }
+        values.clear();
+        values.reserve(source.size());
 
-            mStream.clear();
-        }
-        else
+        for(const auto& it: source)
         {
-            throw std::runtime_error("Could not remove, stream failed");
+            values.push_back(convert(it, get_allocator()));
         }
     }
 
-private:
     ////////////////////////////////////////////////////////////
     // Member data
     ////////////////////////////////////////////////////////////
-    std::fstream            mStream;    ///< Stream
-    std::filesystem::path   mFile;      ///< Path to the file to operate
-    Key                     mKey;       ///< Key
+    std::pmr::string        name;   ///< Name of the key
+    std::pmr::vector<Types> values; ///< Values of the key
 };
 
 ////////////////////////////////////////////////////////////
-/// \brief Stream wrapper class for a locker-room type
-/// database based on files
+/// \brief Memory resource handing out memory from an inline
+/// buffer first, then from larger and larger blocks, and
+/// releasing everything at once when destroyed
+///
+/// An arena of a few hundred bytes on the stack holds a key of
+/// a few values without any allocation.
 ///
 ////////////////////////////////////////////////////////////
-class Room
+template<std::size_t Size>
+class Arena : public std::pmr::monotonic_buffer_resource
 {
 public:
     ////////////////////////////////////////////////////////////
-    /// \brief Default constructor
+    /// \brief Construct an arena
+    ///
+    /// \param upstream Memory resource of the blocks once the
+    /// inline buffer is used, the default one by default
     ///
     ////////////////////////////////////////////////////////////
-            Room() : mBase(std::filesystem::current_path())
+    explicit    Arena(std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) : std::pmr::monotonic_buffer_resource(mBuffer, Size, upstream)
     {
-        //ctor
+
     }
 
+private:
     ////////////////////////////////////////////////////////////
-    /// \brief Default destructor
-    ///
+    // Member data
     ////////////////////////////////////////////////////////////
-            ~Room()
-    {
-        //dtor
-    }
+    alignas(std::max_align_t) std::byte mBuffer[Size]; ///< Inline buffer
+};
+
+} // namespace pmr
+
+////////////////////////////////////////////////////////////
+/// \brief Key whose values have types known at compile time,
+/// decoded straight from a drawer without guessing them
+///
+/// Values are std::string, int, double or bool like the values
+/// of a Key. A record whose values don't match the types is
+/// rejected with an exception.
+///
+////////////////////////////////////////////////////////////
+template<typename... Ts>
+struct Record
+{
+    static_assert(sizeof...(Ts) > 0, "A record holds at least one value");
+    static_assert(((std::is_same_v<Ts, std::string> || std::is_same_v<Ts, int> || std::is_same_v<Ts, double> || std::is_same_v<Ts, bool>) && ...), "Values of a record are std::string, int, double or bool");
+
+    ////////////////////////////////////////////////////////////
+    using Tuple = std::tuple<Ts...>; ///< Values of the record
 
     ////////////////////////////////////////////////////////////
-    /// \brief Set the base directory, current path by default
+    /// \brief Replace the values with the values of a key
     ///
-    /// \param directory Path to the directory
-    /// \param create If true and directory doesn't exist create
-    /// a new one, false by default
+    /// \param source Values to copy, of the types of the record
     ///
     ////////////////////////////////////////////////////////////
-    void    connect(const std::filesystem::path& directory, bool create = false)
+    void        assign(const std::vector<Types>& source)
     {
-        if(std::filesystem::exists(directory))
+        if(source.size() != sizeof...(Ts))
         {
-            if(std::filesystem::is_directory(directory))
-            {
-                mBase = std::filesystem::absolute(directory);
-            }
-            else
-            {
-                throw std::runtime_error("Invalid path, must be a directory.");
-            }
+            throw std::runtime_error("Malformed record, expected " + std::to_string(sizeof...(Ts)) + " values");
         }
-        else if(create)
+
+        std::size_t i = 0;
+
+        std::apply([&source, &i](auto&... typed)
         {
-            std::filesystem::create_directories(directory);
+            ((typed = convert<std::decay_t<decltype(typed)>>(source[i++])), ...);
+        }, values);
+    }
 
-            mBase = std::filesystem::absolute(directory);
+    ////////////////////////////////////////////////////////////
+    /// \brief Copy to a key
+    ///
+    /// \return Key with the name and values of the record
+    ///
+    ////////////////////////////////////////////////////////////
+    Key         key() const
+    {
+        Key converted{name, {}};
+        converted.values.reserve(sizeof...(Ts));
+
+        std::apply([&converted](const auto&... typed)
+        {
+            (converted.values.push_back(Types(typed)), ...);
+        }, values);
+
+        return converted;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Copy the values to a structure
+    ///
+    /// \return Structure initialized with the values in order
+    ///
+    ////////////////////////////////////////////////////////////
+    template<typename Struct>
+    Struct      as() const
+    {
+        return std::apply([](const auto&... typed){ return Struct{typed...}; }, values);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get a value of a key, checking its type
+    ///
+    /// \param value Value
+    ///
+    /// \return Value of the type
+    ///
+    ////////////////////////////////////////////////////////////
+    template<typename T>
+    static T    convert(const Types& value)
+    {
+        if(!std::holds_alternative<T>(value))
+        {
+            throw std::runtime_error("Malformed record, a value has another type");
         }
-        else
+
+        return std::get<T>(value);
+    }
+
+    std::string name;   ///< Name of the key
+    Tuple       values; ///< Values
+};
+
+////////////////////////////////////////////////////////////
+/// \brief Encodings of a drawer
+///
+////////////////////////////////////////////////////////////
+enum class Encoding
+{
+    Text,       ///< Lines of name:values, values separated by commas
+    Binary,     ///< Header followed by length-prefixed records of tagged values
+    Compressed  ///< Binary records sorted by name in blocks compressed on their own, followed by an index of the blocks
+};
+
+////////////////////////////////////////////////////////////
+/// \brief Durability of the modifications made through a room
+///
+////////////////////////////////////////////////////////////
+enum class Durability
+{
+    None,   ///< Modifications reach the disk when the system writes them back
+    Batch,  ///< Modifications are logged, each operation of the room syncs the log before returning
+    Write   ///< Modifications are logged, each write syncs the log before being applied
+};
+
+////////////////////////////////////////////////////////////
+/// \brief Class converting keys to records of a drawer and
+/// back, in any encoding
+///
+/// A binary drawer starts with the magic number 0x89 'C' 'N'
+/// 'R', a version byte and three reserved bytes. Each record
+/// is its length on 4 bytes, a kind byte (0 for a key, 1 for
+/// a removal), the length of the name on 4 bytes and the name,
+/// then for a key the number of values on 4 bytes and the
+/// values. A value is its index in Types followed by its
+/// length and bytes for a string, 4 bytes for an int, 8 bytes
+/// for a double and 1 byte for a bool. Integers are little
+/// endian.
+///
+/// A text drawer escapes ':' and '\\' in names with a '\\'
+/// so that hierarchical names like user:123:mail survive.
+///
+/// A compressed drawer starts with the magic number 0x89 'C'
+/// 'N' 'Z', a version byte and three reserved bytes. Binary
+/// records sorted by name follow in blocks of about 32 KB, each
+/// compressed on its own. The index of the blocks follows: their
+/// number on 4 bytes, then for each block its offset on 8 bytes,
+/// its compressed and original sizes on 4 bytes and the name of
+/// its first key, its length on 4 bytes. The drawer ends with
+/// the offset of the index on 8 bytes and the header again.
+///
+/// Blocks are compressed with a byte-oriented LZ77: a token
+/// byte holds the number of literals and the length of the
+/// match minus 4, a field of 15 continuing in bytes added until
+/// one is below 255. The literals follow the token, then the
+/// distance of the match on 2 bytes. The last sequence of a
+/// block has no match.
+///
+////////////////////////////////////////////////////////////
+class Codec
+{
+public:
+    ////////////////////////////////////////////////////////////
+    /// \brief Record found in a drawer
+    ///
+    ////////////////////////////////////////////////////////////
+    struct Record
+    {
+        std::string_view    name;       ///< Name of the key
+        std::string_view    values;     ///< Encoded values
+        bool                removed;    ///< True if the record removes the key
+        std::size_t         size;       ///< Size of the record, line break or length included
+        std::string         unescaped;  ///< Storage of the name when the record escapes it
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Compressed block of a drawer
+    ///
+    ////////////////////////////////////////////////////////////
+    struct Block
+    {
+        std::uint64_t   offset; ///< Offset of the block in the drawer
+        std::uint32_t   packed; ///< Size of the block compressed
+        std::uint32_t   size;   ///< Size of the block
+        std::string     first;  ///< Name of the first key of the block
+    };
+
+    ////////////////////////////////////////////////////////////
+    static constexpr unsigned char version = 1;     ///< Version of the binary and compressed encodings
+    static constexpr std::size_t block = 32768;     ///< Size above which a block of a compressed drawer is closed
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the header of a binary or compressed drawer
+    ///
+    /// \param encoding Encoding::Binary by default
+    ///
+    /// \return Header
+    ///
+    ////////////////////////////////////////////////////////////
+    static std::string header(Encoding encoding = Encoding::Binary)
+    {
+        return std::string(encoding == Encoding::Compressed ? "\x89" "CNZ" : "\x89" "CNR", 4) + static_cast<char>(version) + std::string(3, '\0');
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Find the encoding of a drawer from its beginning
+    ///
+    /// \param content Beginning of the drawer, at least the size
+    /// of the header if the drawer is long enough
+    ///
+    /// \return Encoding
+    ///
+    ////////////////////////////////////////////////////////////
+    static Encoding detect(std::string_view content)
+    {
+        Encoding encoding = Encoding::Text;
+
+        if(content.size() >= 4 && content.substr(0, 4) == std::string_view("\x89" "CNR", 4))
         {
-            throw std::runtime_error("Path \"" + directory.string() + "\" doesn't point to any file");
+            if(content.size() < header().size() || static_cast<unsigned char>(content[4]) != version)
+            {
+                throw std::runtime_error("Unsupported binary drawer version");
+            }
+
+            encoding = Encoding::Binary;
+        }
+        else if(content.size() >= 4 && content.substr(0, 4) == std::string_view("\x89" "CNZ", 4))
+        {
+            if(content.size() < header().size() || static_cast<unsigned char>(content[4]) != version)
+            {
+                throw std::runtime_error("Unsupported compressed drawer version");
+            }
+
+            encoding = Encoding::Compressed;
         }
+
+        return encoding;
     }
 
     ////////////////////////////////////////////////////////////
-    /// \brief Open a drawer which contains keys to operate on
+    /// \brief Get the offset of the first record
     ///
-    /// \param file Path to the file
-    /// \param function Operations
-    /// \param create Create a new file if path doesn't point to
-    /// any, false by default
+    /// \param encoding Encoding of the drawer
+    ///
+    /// \return Size of the header
     ///
     ////////////////////////////////////////////////////////////
-    void    open(const std::filesystem::path& file, std::function<void(Stream&)> function, bool create = false)
+    static std::size_t origin(Encoding encoding)
+    {
+        return encoding != Encoding::Text ? header().size() : 0;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Encode a key to a record
+    ///
+    /// \param key Key to encode
+    /// \param encoding Encoding of the drawer
+    ///
+    /// \return Record, line break or length included
+    ///
+    ////////////////////////////////////////////////////////////
+    static std::string record(const Key& key, Encoding encoding)
     {
-        bool done = true;
+        std::string encoded;
 
-        if(!std::filesystem::exists(mBase / file))
+        if(encoding != Encoding::Text)
         {
-            if(create)
+            encoded.reserve(13 + key.name.size() + key.values.size() * 9);
+
+            put<std::uint32_t>(encoded, 0);
+            encoded += '\0';
+            put<std::uint32_t>(encoded, static_cast<std::uint32_t>(key.name.size()));
+            encoded += key.name;
+            put<std::uint32_t>(encoded, static_cast<std::uint32_t>(key.values.size()));
+
+            for(const auto& it: key.values)
             {
-                std::ofstream writer(mBase / file);
+                encoded += static_cast<char>(it.index());
 
-                if(writer)
+                if(std::holds_alternative<std::string>(it))
                 {
-                    writer.close();
+                    put<std::uint32_t>(encoded, static_cast<std::uint32_t>(std::get<std::string>(it).size()));
+                    encoded += std::get<std::string>(it);
+                }
+                else if(std::holds_alternative<int>(it))
+                {
+                    put<std::uint32_t>(encoded, static_cast<std::uint32_t>(std::get<int>(it)));
+                }
+                else if(std::holds_alternative<double>(it))
+                {
+                    std::uint64_t bits;
+                    std::memcpy(&bits, &std::get<double>(it), sizeof(bits));
+
+                    put<std::uint64_t>(encoded, bits);
                 }
                 else
                 {
-                    done = false;
-                    throw std::runtime_error("Stream failed to open file on \"" + file.string() + "\"");
+                    encoded += static_cast<char>(std::get<bool>(it));
                 }
             }
-            else
-            {
-                done = false;
-                throw std::runtime_error("Path \"" + file.string() + "\" doesn't point to any file");
-            }
-        }
 
-        if(done)
+            patch(encoded);
+        }
+        else
         {
-            if(std::filesystem::is_regular_file(mBase / file))
-            {
-                Stream stream({mBase / file});
-                function(stream);
-            }
-            else
+            encoded = escape(key.name);
+            encoded += ':';
+
+            for(size_t i = 0; i < key.values.size(); ++i)
             {
-                throw std::runtime_error("Invalid path \"" + file.string() + "\", must be a regular file");
+                std::holds_alternative<std::string>(key.values[i]) ? encoded += '\"' + Key::string(key.values[i]) + '\"' : encoded += Key::string(key.values[i]);
+
+                if(i != key.values.size() - 1)
+                {
+                    encoded += ',';
+                }
             }
+
+            encoded += '\n';
         }
+
+        return encoded;
     }
 
     ////////////////////////////////////////////////////////////
-    /// \brief Check if file exists
+    /// \brief Find a value in a binary record
     ///
-    /// \param file Path to the file
+    /// \param record Binary record, length included
+    /// \param index Position of the value
+    /// \param offset Offset of the tag of the value in the
+    /// record, if found
     ///
-    /// \return True if file exists
+    /// \return True if the record has a value at the position
     ///
     ////////////////////////////////////////////////////////////
-    bool    exists(const std::filesystem::path& file)
+    static bool locate(std::string_view record, std::size_t index, std::size_t& offset)
     {
-        if(std::filesystem::exists(mBase / file))
+        std::string_view cursor = record;
+
+        get<std::uint32_t>(cursor);
+        get<std::uint8_t>(cursor);
+
+        std::size_t size = get<std::uint32_t>(cursor);
+
+        if(size > cursor.size())
         {
-            return true;
+            throw std::runtime_error("Corrupted binary drawer");
         }
-        else
+
+        cursor.remove_prefix(size);
+
+        std::size_t count = get<std::uint32_t>(cursor);
+        bool found = false;
+
+        for(std::size_t i = 0; i < count && !found; ++i)
         {
-            return false;
+            if(i == index)
+            {
+                offset = record.size() - cursor.size();
+                found = true;
+            }
+            else
+            {
+                std::uint8_t tag = get<std::uint8_t>(cursor);
+
+                size = tag == 0 ? get<std::uint32_t>(cursor) : tag == 1 ? 4 : tag == 2 ? 8 : 1;
+
+                if(size > cursor.size())
+                {
+                    throw std::runtime_error("Corrupted binary drawer");
+                }
+
+                cursor.remove_prefix(size);
+            }
         }
+
+        return found;
     }
 
     ////////////////////////////////////////////////////////////
-    /// \brief Destroy a file or directory
+    /// \brief Encode the removal of a key to a record
     ///
-    /// \param file Path to the file
+    /// \param name Name of the key
+    /// \param encoding Encoding of the drawer
+    ///
+    /// \return Record, line break or length included
     ///
     ////////////////////////////////////////////////////////////
-    void    destroy(const std::filesystem::path& file)
+    static std::string tombstone(const std::string& name, Encoding encoding)
     {
-        if(std::filesystem::exists(mBase / file))
+        std::string encoded;
+
+        if(encoding != Encoding::Text)
         {
-            std::filesystem::remove_all(mBase / file);
+            put<std::uint32_t>(encoded, 0);
+            encoded += '\1';
+            put<std::uint32_t>(encoded, static_cast<std::uint32_t>(name.size()));
+            encoded += name;
+
+            patch(encoded);
         }
         else
         {
-            throw std::runtime_error("Path \"" + file.string() + "\" doesn't point to any file");
+            encoded = escape(name);
+            encoded += '\n';
         }
+
+        return encoded;
     }
 
     ////////////////////////////////////////////////////////////
-    /// \brief Short way to write a key in a drawer
+    /// \brief Find the record at a position
     ///
-    /// \param file Path to the file
-    /// \param key Key to write
-    /// \param create Create a new file if path doesn't point to
-    /// any, false by default
+    /// \param content Content of the drawer
+    /// \param position Offset of the record
+    /// \param encoding Encoding of the drawer
+    /// \param record Record to fill
+    ///
+    /// \return False if there is no complete record at the
+    /// position
     ///
     ////////////////////////////////////////////////////////////
-    void    quick_write(const std::filesystem::path& file, const Key& key, bool create = false)
+    static bool next(std::string_view content, std::size_t position, Encoding encoding, Record& record)
     {
-        Stream stream(mBase / file, create);
+        bool found = false;
+
+        if(position < content.size())
+        {
+            std::string_view rest = content.substr(position);
+
+            if(encoding != Encoding::Text)
+            {
+                if(rest.size() >= 4)
+                {
+                    std::string_view cursor = rest;
+
+                    std::size_t size = get<std::uint32_t>(cursor);
+
+                    if(size >= 5 && cursor.size() >= size)
+                    {
+                        cursor = cursor.substr(0, size);
+
+                        record.removed = cursor.front() == '\1';
+                        cursor.remove_prefix(1);
+
+                        std::size_t length = get<std::uint32_t>(cursor);
+
+                        if(length <= cursor.size())
+                        {
+                            record.name = cursor.substr(0, length);
+                            record.values = cursor.substr(length);
+                            record.size = size + 4;
+
+                            found = true;
+                        }
+                    }
+                }
+            }
+            else
+            {
+                auto pos = rest.find('\n');
+
+                std::string_view field = rest.substr(0, pos);
+
+                record.size = pos == std::string_view::npos ? rest.size() : pos + 1;
+
+                if(!field.empty() && field.back() == '\r')
+                {
+                    field.remove_suffix(1);
+                }
+
+                auto colon = field.find_first_of(":\\");
+
+                if(colon != std::string_view::npos && field[colon] == '\\')
+                {
+                    record.unescaped.assign(field.substr(0, colon));
+
+                    bool done = false;
+                    while(!done)
+                    {
+                        if(colon >= field.size())
+                        {
+                            colon = std::string_view::npos;
+                            done = true;
+                        }
+                        else if(field[colon] == ':')
+                        {
+                            done = true;
+                        }
+                        else
+                        {
+                            if(field[colon] == '\\' && colon + 1 < field.size())
+                            {
+                                ++colon;
+                            }
+
+                            record.unescaped += field[colon++];
+                        }
+                    }
+
+                    record.name = record.unescaped;
+                }
+                else
+                {
+                    record.name = field.substr(0, colon);
+                }
+
+                record.removed = colon == std::string_view::npos;
+                record.values = record.removed ? std::string_view() : field.substr(colon + 1);
+
+                found = true;
+            }
+        }
 
-        stream << key;
+        return found;
     }
 
     ////////////////////////////////////////////////////////////
-    /// \brief Short way to read a key from a drawer
+    /// \brief Decode the values of a record
     ///
-    /// \param file Path to the file, must exist
-    /// \param name Name of the key
+    /// \param values Encoded values
+    /// \param encoding Encoding of the drawer
+    /// \param key Key or pmr::Key to fill
     ///
     ////////////////////////////////////////////////////////////
-    Key     quick_read(const std::filesystem::path& file, const std::string& name)
+    template<typename Filled>
+    static void parse(std::string_view values, Encoding encoding, Filled& key)
     {
-        Stream stream(mBase / file);
+        if(encoding != Encoding::Text)
+        {
+            std::size_t count = get<std::uint32_t>(values);
 
-        stream >> name;
+            key.values.reserve(key.values.size() + count);
 
-        return stream();
-    }
+            for(std::size_t i = 0; i < count; ++i)
+            {
+                push(key, take(values));
+            }
+        }
+        else
+        {
+            bool done = false;
 
-protected:
+            size_t last = 0;
+            while(!done)
+            {
+                auto pos = values.find(',', last);
+
+                push(key, value(values.substr(last, pos == std::string_view::npos ? pos : pos - last)));
+
+                if(pos != std::string_view::npos)
+                {
+                    last = pos + 1;
+                }
+                else
+                {
+                    done = true;
+                }
+            }
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Decode the values of a record straight into a typed
+    /// record, each value parsed as the type expected
+    ///
+    /// \param values Encoded values
+    /// \param encoding Encoding of the drawer
+    /// \param record Typed record to fill
+    ///
+    ////////////////////////////////////////////////////////////
+    template<typename... Ts>
+    static void parse(std::string_view values, Encoding encoding, CNRoom::Record<Ts...>& record)
+    {
+        typed(values, encoding, record.values, std::index_sequence_for<Ts...>());
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Add a copy of a viewed value to a key
+    ///
+    /// \param key Key
+    /// \param value Value viewing a drawer
+    ///
+    ////////////////////////////////////////////////////////////
+    static void push(Key& key, const Views& value)
+    {
+        key.values.push_back(own(value));
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Add a copy of a viewed value to a key, its string
+    /// is allocated by the allocator of the key
+    ///
+    /// \param key Key
+    /// \param value Value viewing a drawer
+    ///
+    ////////////////////////////////////////////////////////////
+    static void push(pmr::Key& key, const Views& value)
+    {
+        key.values.push_back(pmr::Key::convert(value, key.get_allocator()));
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Copy a viewed value
+    ///
+    /// \param value Value viewing a drawer
+    ///
+    /// \return Value owning its string
+    ///
+    ////////////////////////////////////////////////////////////
+    static Types own(const Views& value)
+    {
+        Types owned = std::string();
+
+        if(std::holds_alternative<std::string_view>(value))
+        {
+            owned = std::string(std::get<std::string_view>(value));
+        }
+        else if(std::holds_alternative<int>(value))
+        {
+            owned = std::get<int>(value);
+        }
+        else if(std::holds_alternative<double>(value))
+        {
+            owned = std::get<double>(value);
+        }
+        else
+        {
+            owned = std::get<bool>(value);
+        }
+
+        return owned;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Convert a value of a text drawer, numbers are
+    /// converted with std::from_chars which neither allocates
+    /// nor depends on the locale
+    ///
+    /// \param token Value as written in the drawer
+    ///
+    /// \return Value, strings view the token
+    ///
+    ////////////////////////////////////////////////////////////
+    static Views value(std::string_view token)
+    {
+        Views converted = std::string_view();
+
+        if(token.empty())
+        {
+            converted = token;
+        }
+        else if(token == "true")
+        {
+            converted = true;
+        }
+        else if(token == "false")
+        {
+            converted = false;
+        }
+        else if(token.size() > 1 && token.front() == '\"' && token.back() == '\"')
+        {
+            converted = token.substr(1, token.size() - 2);
+        }
+        else if(token.find('.') != std::string_view::npos)
+        {
+            double number = 0;
+
+            if(std::from_chars(token.data(), token.data() + token.size(), number).ec != std::errc())
+            {
+                throw std::runtime_error("Invalid value \"" + std::string(token) + "\"");
+            }
+
+            converted = number;
+        }
+        else
+        {
+            int number = 0;
+
+            if(std::from_chars(token.data(), token.data() + token.size(), number).ec != std::errc())
+            {
+                throw std::runtime_error("Invalid value \"" + std::string(token) + "\"");
+            }
+
+            converted = number;
+        }
+
+        return converted;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Decode the next value of a binary drawer
+    ///
+    /// \param cursor Encoded values, moved past the value
+    ///
+    /// \return Value, strings view the cursor
+    ///
+    ////////////////////////////////////////////////////////////
+    static Views take(std::string_view& cursor)
+    {
+        Views converted = std::string_view();
+
+        std::size_t tag = get<std::uint8_t>(cursor);
+
+        if(tag == 0)
+        {
+            std::size_t length = get<std::uint32_t>(cursor);
+
+            if(length > cursor.size())
+            {
+                throw std::runtime_error("Corrupted binary drawer");
+            }
+
+            converted = cursor.substr(0, length);
+            cursor.remove_prefix(length);
+        }
+        else if(tag == 1)
+        {
+            converted = static_cast<int>(get<std::uint32_t>(cursor));
+        }
+        else if(tag == 2)
+        {
+            std::uint64_t bits = get<std::uint64_t>(cursor);
+
+            double number;
+            std::memcpy(&number, &bits, sizeof(number));
+
+            converted = number;
+        }
+        else if(tag == 3)
+        {
+            converted = get<std::uint8_t>(cursor) != 0;
+        }
+        else
+        {
+            throw std::runtime_error("Corrupted binary drawer");
+        }
+
+        return converted;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Read an unsigned integer in little endian
+    ///
+    /// \param cursor Bytes, moved past the integer
+    ///
+    /// \return Integer
+    ///
+    ////////////////////////////////////////////////////////////
+    template <typename T>
+    static T    get(std::string_view& cursor)
+    {
+        if(cursor.size() < sizeof(T))
+        {
+            throw std::runtime_error("Corrupted binary drawer");
+        }
+
+        T value = 0;
+
+        for(std::size_t i = 0; i < sizeof(T); ++i)
+        {
+            value |= static_cast<T>(static_cast<T>(static_cast<unsigned char>(cursor[i])) << (8 * i));
+        }
+
+        cursor.remove_prefix(sizeof(T));
+
+        return value;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Write an unsigned integer in little endian
+    ///
+    /// \param bytes Bytes to append to
+    /// \param value Integer
+    ///
+    ////////////////////////////////////////////////////////////
+    template <typename T>
+    static void put(std::string& bytes, T value)
+    {
+        for(std::size_t i = 0; i < sizeof(T); ++i)
+        {
+            bytes += static_cast<char>((value >> (8 * i)) & 0xFF);
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Compress a block
+    ///
+    /// Repeated sequences of 4 bytes or more within the last 64
+    /// KB are found through a table of the last position of each
+    /// hashed sequence, and replaced by their distance and length.
+    ///
+    /// \param raw Block
+    ///
+    /// \return Compressed block
+    ///
+    ////////////////////////////////////////////////////////////
+    static std::string compress(std::string_view raw)
+    {
+        const std::size_t bits = 14;
+
+        std::vector<std::uint32_t> table(std::size_t(1) << bits, 0);
+
+        std::string packed;
+        packed.reserve(raw.size() / 2 + 16);
+
+        auto sequence = [&raw](std::size_t position)
+        {
+            std::uint32_t value;
+            std::memcpy(&value, raw.data() + position, sizeof(value));
+
+            return value;
+        };
+
+        auto length = [&packed](std::size_t value)
+        {
+            for(; value >= 255; value -= 255)
+            {
+                packed += static_cast<char>(255);
+            }
+
+            packed += static_cast<char>(value);
+        };
+
+        auto emit = [&](std::size_t anchor, std::size_t literals, std::size_t distance, std::size_t match)
+        {
+            std::size_t extra = match >= 4 ? match - 4 : 0;
+
+            packed += static_cast<char>((std::min<std::size_t>(literals, 15) << 4) | std::min<std::size_t>(extra, 15));
+
+            if(literals >= 15)
+            {
+                length(literals - 15);
+            }
+
+            packed.append(raw.data() + anchor, literals);
+
+            if(match >= 4)
+            {
+                put<std::uint16_t>(packed, static_cast<std::uint16_t>(distance));
+
+                if(extra >= 15)
+                {
+                    length(extra - 15);
+                }
+            }
+        };
+
+        std::size_t anchor = 0;
+        std::size_t position = 0;
+
+        while(position + 4 <= raw.size())
+        {
+            std::uint32_t value = sequence(position);
+            std::uint32_t& slot = table[(value * 2654435761u) >> (32 - bits)];
+
+            std::size_t candidate = slot;
+            slot = static_cast<std::uint32_t>(position + 1);
+
+            if(candidate > 0 && position + 1 - candidate <= 65535 && sequence(candidate - 1) == value)
+            {
+                --candidate;
+
+                std::size_t match = 4;
+
+                while(position + match < raw.size() && raw[candidate + match] == raw[position + match])
+                {
+                    ++match;
+                }
+
+                emit(anchor, position - anchor, position - candidate, match);
+
+                position += match;
+                anchor = position;
+            }
+            else
+            {
+                ++position;
+            }
+        }
+
+        emit(anchor, raw.size() - anchor, 0, 0);
+
+        return packed;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Decompress a block
+    ///
+    /// \param packed Compressed block
+    /// \param size Size of the block
+    /// \param raw String to fill with the block
+    ///
+    ////////////////////////////////////////////////////////////
+    static void decompress(std::string_view packed, std::size_t size, std::string& raw)
+    {
+        raw.clear();
+        raw.reserve(size);
+
+        auto length = [&packed](std::size_t value)
+        {
+            bool done = value < 15;
+
+            while(!done)
+            {
+                if(packed.empty())
+                {
+                    throw std::runtime_error("Corrupted compressed drawer");
+                }
+
+                unsigned char byte = static_cast<unsigned char>(packed.front());
+                packed.remove_prefix(1);
+
+                value += byte;
+                done = byte < 255;
+            }
+
+            return value;
+        };
+
+        while(!packed.empty())
+        {
+            unsigned char token = static_cast<unsigned char>(packed.front());
+            packed.remove_prefix(1);
+
+            std::size_t literals = length(token >> 4);
+
+            if(literals > packed.size() || raw.size() + literals > size)
+            {
+                throw std::runtime_error("Corrupted compressed drawer");
+            }
+
+            raw.append(packed.data(), literals);
+            packed.remove_prefix(literals);
+
+            if(!packed.empty())
+            {
+                std::size_t distance = get<std::uint16_t>(packed);
+                std::size_t match = length(token & 0x0F) + 4;
+
+                if(distance == 0 || distance > raw.size() || raw.size() + match > size)
+                {
+                    throw std::runtime_error("Corrupted compressed drawer");
+                }
+
+                std::size_t from = raw.size() - distance;
+                std::size_t to = raw.size();
+
+                raw.resize(to + match);
+
+                for(std::size_t i = 0; i < match; ++i)
+                {
+                    raw[to + i] = raw[from + i];
+                }
+            }
+        }
+
+        if(raw.size() != size)
+        {
+            throw std::runtime_error("Corrupted compressed drawer");
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the index of the blocks and the end of a
+    /// compressed drawer
+    ///
+    /// \param blocks Blocks of the drawer
+    /// \param offset Size of the drawer, its header and blocks
+    /// written
+    ///
+    /// \return Bytes to append to the drawer
+    ///
+    ////////////////////////////////////////////////////////////
+    static std::string footer(const std::vector<Block>& blocks, std::uint64_t offset)
+    {
+        std::string content;
+
+        put<std::uint32_t>(content, static_cast<std::uint32_t>(blocks.size()));
+
+        for(const auto& it: blocks)
+        {
+            put<std::uint64_t>(content, it.offset);
+            put<std::uint32_t>(content, it.packed);
+            put<std::uint32_t>(content, it.size);
+            put<std::uint32_t>(content, static_cast<std::uint32_t>(it.first.size()));
+            content += it.first;
+        }
+
+        put<std::uint64_t>(content, offset);
+        content += header(Encoding::Compressed);
+
+        return content;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Find the index of the blocks from the end of a
+    /// compressed drawer
+    ///
+    /// \param end Last 16 bytes of the drawer
+    /// \param size Size of the drawer
+    ///
+    /// \return Offset of the index
+    ///
+    ////////////////////////////////////////////////////////////
+    static std::uint64_t trailer(std::string_view end, std::uint64_t size)
+    {
+        std::uint64_t offset = 0;
+
+        if(end.size() == 16 && end.substr(8) == header(Encoding::Compressed))
+        {
+            offset = get<std::uint64_t>(end);
+        }
+
+        if(offset < header().size() || offset + 16 > size)
+        {
+            throw std::runtime_error("Corrupted compressed drawer");
+        }
+
+        return offset;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Decode the index of the blocks of a compressed
+    /// drawer
+    ///
+    /// \param bytes Index, between its offset and the last 16
+    /// bytes of the drawer
+    ///
+    /// \return Blocks in the order of the drawer
+    ///
+    ////////////////////////////////////////////////////////////
+    static std::vector<Block> blocks(std::string_view bytes)
+    {
+        std::size_t count = get<std::uint32_t>(bytes);
+
+        if(count > bytes.size())
+        {
+            throw std::runtime_error("Corrupted compressed drawer");
+        }
+
+        std::vector<Block> blocks(count);
+
+        for(auto& it: blocks)
+        {
+            it.offset = get<std::uint64_t>(bytes);
+            it.packed = get<std::uint32_t>(bytes);
+            it.size = get<std::uint32_t>(bytes);
+
+            std::size_t length = get<std::uint32_t>(bytes);
+
+            if(length > bytes.size())
+            {
+                throw std::runtime_error("Corrupted compressed drawer");
+            }
+
+            it.first.assign(bytes.substr(0, length));
+            bytes.remove_prefix(length);
+        }
+
+        return blocks;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Compute the 64 bits FNV-1a hash of bytes
+    ///
+    /// \param bytes Bytes
+    ///
+    /// \return Hash
+    ///
+    ////////////////////////////////////////////////////////////
+    static std::uint64_t fnv(std::string_view bytes)
+    {
+        std::uint64_t value = 14695981039346656037ull;
+
+        for(char it: bytes)
+        {
+            value ^= static_cast<unsigned char>(it);
+            value *= 1099511628211ull;
+        }
+
+        return value;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Compute the stable hash of bytes, fnv() with its
+    /// bits mixed so that the low bits depend on every byte
+    ///
+    /// \param bytes Bytes
+    ///
+    /// \return Hash
+    ///
+    ////////////////////////////////////////////////////////////
+    static std::uint64_t hash(std::string_view bytes)
+    {
+        std::uint64_t value = fnv(bytes);
+
+        value ^= value >> 33;
+        value *= 0xFF51AFD7ED558CCDull;
+        value ^= value >> 33;
+        value *= 0xC4CEB9FE1A85EC53ull;
+        value ^= value >> 33;
+
+        return value;
+    }
+
+private:
+    ////////////////////////////////////////////////////////////
+    /// \brief Decode values into a tuple of known types
+    ///
+    /// \param values Encoded values
+    /// \param encoding Encoding of the drawer
+    /// \param tuple Tuple to fill
+    ///
+    ////////////////////////////////////////////////////////////
+    template<typename Tuple, std::size_t... Is>
+    static void typed(std::string_view values, Encoding encoding, Tuple& tuple, std::index_sequence<Is...>)
+    {
+        if(encoding != Encoding::Text)
+        {
+            if(get<std::uint32_t>(values) != sizeof...(Is))
+            {
+                throw std::runtime_error("Malformed record, expected " + std::to_string(sizeof...(Is)) + " values");
+            }
+
+            (assign(take(values), std::get<Is>(tuple)), ...);
+        }
+        else
+        {
+            std::size_t last = 0;
+
+            (convert(token(values, last, Is + 1 == sizeof...(Is)), std::get<Is>(tuple)), ...);
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Cut the next value of a text record
+    ///
+    /// \param values Encoded values
+    /// \param last Start of the value, moved past its comma
+    /// \param final True if the value must be the last one
+    ///
+    /// \return Value as written in the drawer
+    ///
+    ////////////////////////////////////////////////////////////
+    static std::string_view token(std::string_view values, std::size_t& last, bool final)
+    {
+        auto pos = values.find(',', last);
+
+        if(final != (pos == std::string_view::npos))
+        {
+            throw std::runtime_error("Malformed record, wrong number of values");
+        }
+
+        std::string_view cut = values.substr(last, pos == std::string_view::npos ? pos : pos - last);
+
+        last = pos + 1;
+
+        return cut;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Convert a value of a text drawer to the type
+    /// expected, a double is written with a dot and a string
+    /// within quotes
+    ///
+    /// \param token Value as written in the drawer
+    /// \param typed Value to fill
+    ///
+    ////////////////////////////////////////////////////////////
+    template<typename T>
+    static void convert(std::string_view token, T& typed)
+    {
+        bool valid = false;
+
+        if constexpr(std::is_same_v<T, std::string>)
+        {
+            if(token.empty())
+            {
+                typed.clear();
+                valid = true;
+            }
+            else if(token.size() > 1 && token.front() == '\"' && token.back() == '\"')
+            {
+                typed.assign(token.substr(1, token.size() - 2));
+                valid = true;
+            }
+        }
+        else if constexpr(std::is_same_v<T, bool>)
+        {
+            typed = token == "true";
+            valid = typed || token == "false";
+        }
+        else if((token.find('.') != std::string_view::npos) == std::is_same_v<T, double>)
+        {
+            auto result = std::from_chars(token.data(), token.data() + token.size(), typed);
+
+            valid = result.ec == std::errc() && result.ptr == token.data() + token.size();
+        }
+
+        if(!valid)
+        {
+            throw std::runtime_error("Malformed value \"" + std::string(token) + "\"");
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Copy a value of a binary drawer, checking its type
+    ///
+    /// \param value Value viewing a drawer
+    /// \param typed Value to fill
+    ///
+    ////////////////////////////////////////////////////////////
+    template<typename T>
+    static void assign(const Views& value, T& typed)
+    {
+        using Viewed = std::conditional_t<std::is_same_v<T, std::string>, std::string_view, T>;
+
+        if(!std::holds_alternative<Viewed>(value))
+        {
+            throw std::runtime_error("Malformed record, a value has another type");
+        }
+
+        typed = T(std::get<Viewed>(value));
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Escape a name for a text drawer
+    ///
+    /// \param name Name of a key
+    ///
+    /// \return Name with ':' and '\\' escaped
+    ///
+    ////////////////////////////////////////////////////////////
+    static std::string escape(std::string_view name)
+    {
+        std::string escaped;
+        escaped.reserve(name.size());
+
+        for(char it: name)
+        {
+            if(it == ':' || it == '\\')
+            {
+                escaped += '\\';
+            }
+
+            escaped += it;
+        }
+
+        return escaped;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Write the length of a binary record in its first
+    /// 4 bytes
+    ///
+    /// \param encoded Record
+    ///
+    ////////////////////////////////////////////////////////////
+    static void patch(std::string& encoded)
+    {
+        std::string length;
+        put<std::uint32_t>(length, static_cast<std::uint32_t>(encoded.size() - 4));
+
+        encoded.replace(0, 4, length);
+    }
+};
+
+////////////////////////////////////////////////////////////
+/// \brief Class collecting writes and removals to apply them
+/// on a stream at once
+///
+////////////////////////////////////////////////////////////
+class WriteBatch
+{
+public:
+    ////////////////////////////////////////////////////////////
+    /// \brief Add a key to write, replaces any previous operation
+    /// on the same key
+    ///
+    /// \param key Key to write
+    ///
+    ////////////////////////////////////////////////////////////
+    void        write(const Key& key)
+    {
+        set(key.name, key);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Add a key to remove, replaces any previous
+    /// operation on the same key
+    ///
+    /// \param name Name of the key to remove
+    ///
+    ////////////////////////////////////////////////////////////
+    void        remove(const std::string& name)
+    {
+        set(name, std::nullopt);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Remove every operation
+    ///
+    ////////////////////////////////////////////////////////////
+    void        clear()
+    {
+        mOperations.clear();
+        mPositions.clear();
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Check if the batch has no operation
+    ///
+    /// \return True if empty
+    ///
+    ////////////////////////////////////////////////////////////
+    bool        empty() const
+    {
+        return mOperations.empty();
+    }
+
+private:
+    friend class Journal;
+    friend class Room;
+    friend class ShardedDrawer;
+    friend class Stream;
+
+    ////////////////////////////////////////////////////////////
+    using Operation = std::pair<std::string, std::optional<Key>>; ///< Name and key to write, no key to remove
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Set the operation on a key
+    ///
+    /// \param name Name of the key
+    /// \param key Key to write, std::nullopt to remove
+    ///
+    ////////////////////////////////////////////////////////////
+    void        set(const std::string& name, std::optional<Key> key)
+    {
+        auto found = mPositions.find(name);
+
+        if(found != mPositions.end())
+        {
+            mOperations[found->second].second = std::move(key);
+        }
+        else
+        {
+            mPositions.emplace(name, mOperations.size());
+            mOperations.emplace_back(name, std::move(key));
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Find the operation on a key
+    ///
+    /// \param name Name of the key
+    ///
+    /// \return Operation, nullptr if the key isn't in the batch
+    ///
+    ////////////////////////////////////////////////////////////
+    const Operation* find(const std::string& name) const
+    {
+        auto found = mPositions.find(name);
+
+        return found != mPositions.end() ? &mOperations[found->second] : nullptr;
+    }
+
+    ////////////////////////////////////////////////////////////
+    // Member data
+    ////////////////////////////////////////////////////////////
+    std::vector<Operation>                          mOperations;    ///< Operations in order of first use
+    std::unordered_map<std::string, std::size_t>    mPositions;     ///< Position of each key in the operations
+};
+
+////////////////////////////////////////////////////////////
+/// \brief Write-ahead log of the modifications made through a
+/// room, replayed into the drawers after a crash
+///
+/// Each modification is logged before it's applied to its
+/// drawer. Threads waiting for the log to reach the disk
+/// share one sync: the first one syncs everything logged so
+/// far while the others wait for it. Drawers are synced and
+/// the log is emptied once it grows large.
+///
+/// A log is a sequence of frames: the length of the payload
+/// on 4 bytes, its checksum on 8 bytes, then the payload made
+/// of the length of the drawer path on 4 bytes, the path and
+/// the binary records of the modification. Integers are
+/// little endian.
+///
+////////////////////////////////////////////////////////////
+class Journal
+{
+public:
+    ////////////////////////////////////////////////////////////
+    using Entries = std::vector<std::pair<std::string, std::string>>; ///< Drawer and binary records of each logged modification
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Logs a modification of a drawer for the lifetime
+    /// of the object, the modification is applied meanwhile
+    ///
+    ////////////////////////////////////////////////////////////
+    class Entry
+    {
+    public:
+        ////////////////////////////////////////////////////////////
+        /// \brief Log a batch of writes and removals
+        ///
+        /// \param journal Journal, nothing is logged if null
+        /// \param file Path to the drawer
+        /// \param batch Operations
+        ///
+        ////////////////////////////////////////////////////////////
+                    Entry(const std::shared_ptr<Journal>& journal, const std::filesystem::path& file, const WriteBatch& batch) : mJournal(journal.get()), mFile(file), mTicket(0)
+        {
+            if(mJournal)
+            {
+                std::string records;
+
+                for(const auto& it: batch.mOperations)
+                {
+                    records += it.second ? Codec::record(*it.second, Encoding::Binary) : Codec::tombstone(it.first, Encoding::Binary);
+                }
+
+                mTicket = mJournal->log(mFile, records);
+            }
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Log a write
+        ///
+        /// \param journal Journal, nothing is logged if null
+        /// \param file Path to the drawer
+        /// \param key Key to write
+        ///
+        ////////////////////////////////////////////////////////////
+                    Entry(const std::shared_ptr<Journal>& journal, const std::filesystem::path& file, const Key& key) : mJournal(journal.get()), mFile(file), mTicket(0)
+        {
+            if(mJournal)
+            {
+                mTicket = mJournal->log(mFile, Codec::record(key, Encoding::Binary));
+            }
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Log a removal
+        ///
+        /// \param journal Journal, nothing is logged if null
+        /// \param file Path to the drawer
+        /// \param name Name of the key to remove
+        ///
+        ////////////////////////////////////////////////////////////
+                    Entry(const std::shared_ptr<Journal>& journal, const std::filesystem::path& file, const std::string& name) : mJournal(journal.get()), mFile(file), mTicket(0)
+        {
+            if(mJournal)
+            {
+                mTicket = mJournal->log(mFile, Codec::tombstone(name, Encoding::Binary));
+            }
+        }
+
+                    Entry(const Entry&) = delete;
+        Entry&      operator =(const Entry&) = delete;
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Mark the modification as applied
+        ///
+        ////////////////////////////////////////////////////////////
+                    ~Entry()
+        {
+            if(mJournal)
+            {
+                mJournal->applied(mTicket, mFile);
+            }
+        }
+
+    private:
+        ////////////////////////////////////////////////////////////
+        // Member data
+        ////////////////////////////////////////////////////////////
+        Journal*                        mJournal;   ///< Journal
+        const std::filesystem::path&    mFile;      ///< Path to the drawer
+        std::uint64_t                   mTicket;    ///< Position of the end of the entry in the log
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Start a new log in a room, the log is locked while
+    /// the journal is alive
+    ///
+    /// \param directory Base directory of the room
+    /// \param durability Durability::Batch or Durability::Write
+    ///
+    ////////////////////////////////////////////////////////////
+                Journal(const std::filesystem::path& directory, Durability durability) : mDirectory(directory), mDescriptor(-1), mDurability(durability), mWritten(0), mSynced(0), mSyncing(false), mSize(0)
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        static std::atomic<unsigned> count(0);
+
+        std::filesystem::create_directories(directory / ".cnroom");
+
+        mFile = directory / ".cnroom" / ("journal." + std::to_string(::getpid()) + "." + std::to_string(count++));
+
+        mDescriptor = ::open(mFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+
+        if(mDescriptor < 0 || ::flock(mDescriptor, LOCK_EX | LOCK_NB) != 0)
+        {
+            throw std::runtime_error("Failed to open journal on \"" + mFile.string() + "\"");
+        }
+#else
+        throw std::runtime_error("Durability isn't available on this platform");
+#endif
+    }
+
+                Journal(const Journal&) = delete;
+    Journal&    operator =(const Journal&) = delete;
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Destructor, the log is removed once every logged
+    /// modification reached its drawer
+    ///
+    ////////////////////////////////////////////////////////////
+                ~Journal()
+    {
+        try
+        {
+            checkpoint();
+
+            std::filesystem::remove(mFile);
+        }
+        catch(const std::exception&)
+        {
+
+        }
+
+#if defined(__unix__) || defined(__APPLE__)
+        if(mDescriptor >= 0)
+        {
+            ::close(mDescriptor);
+        }
+#endif
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Set when logged modifications are synced
+    ///
+    /// \param durability Durability::Batch or Durability::Write
+    ///
+    ////////////////////////////////////////////////////////////
+    void        set_durability(Durability durability)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        mDurability = durability;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get when logged modifications are synced
+    ///
+    /// \return Durability
+    ///
+    ////////////////////////////////////////////////////////////
+    Durability  durability()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        return mDurability;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Wait until every logged modification is on disk
+    ///
+    ////////////////////////////////////////////////////////////
+    void        sync()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        durable(mWritten, lock);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Empty the log if it grew large
+    ///
+    ////////////////////////////////////////////////////////////
+    void        collect()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        if(mSize > limit)
+        {
+            lock.unlock();
+
+            checkpoint();
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Sync the drawers modified since the last
+    /// checkpoint and empty the log, but for the modifications
+    /// still being applied
+    ///
+    ////////////////////////////////////////////////////////////
+    void        checkpoint()
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        while(mSyncing)
+        {
+            mCondition.wait(lock);
+        }
+
+        if(mSize > 0)
+        {
+            std::unordered_set<std::string> directories;
+
+            for(const auto& it: mDirty)
+            {
+                persist(it);
+
+                directories.insert(std::filesystem::path(it).parent_path().string());
+            }
+
+            for(const auto& it: directories)
+            {
+                persist(it);
+            }
+
+            std::string content;
+
+            for(const auto& it: mPending)
+            {
+                content += it.second;
+            }
+
+            std::filesystem::path temporary = mFile.string() + ".tmp";
+
+            int descriptor = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+
+            if(descriptor < 0)
+            {
+                throw std::runtime_error("Failed to open journal on \"" + temporary.string() + "\"");
+            }
+
+            if(::flock(descriptor, LOCK_EX | LOCK_NB) != 0 || !write(descriptor, content) || ::fsync(descriptor) != 0)
+            {
+                ::close(descriptor);
+
+                throw std::runtime_error("Could not checkpoint, journal failed");
+            }
+
+            std::filesystem::rename(temporary, mFile);
+
+            persist(mFile.parent_path());
+
+            ::close(mDescriptor);
+            mDescriptor = descriptor;
+
+            mSize = content.size();
+            mSynced = mWritten;
+            mDirty.clear();
+
+            mCondition.notify_all();
+        }
+#endif
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Replay the logs left by rooms which didn't close,
+    /// each log is removed once replayed
+    ///
+    /// Logs locked by a living journal are left alone. A frame
+    /// cut by a crash ends its log.
+    ///
+    /// \param directory Base directory of the room
+    /// \param replay Function applying the modifications of a
+    /// log to their drawers, on disk once it returns
+    ///
+    ////////////////////////////////////////////////////////////
+    static void recover(const std::filesystem::path& directory, const std::function<void(const Entries&)>& replay)
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        std::error_code error;
+
+        std::vector<std::filesystem::path> logs;
+
+        for(std::filesystem::directory_iterator it(directory / ".cnroom", error), end; !error && it != end; it.increment(error))
+        {
+            std::string name = it->path().filename().string();
+
+            if(name.compare(0, 8, "journal.") == 0 && name.size() > 4 && name.compare(name.size() - 4, 4, ".tmp") != 0)
+            {
+                logs.push_back(it->path());
+            }
+        }
+
+        for(const auto& it: logs)
+        {
+            int descriptor = ::open(it.c_str(), O_RDONLY);
+
+            if(descriptor >= 0)
+            {
+                struct stat opened;
+                struct stat current;
+
+                if(::flock(descriptor, LOCK_EX | LOCK_NB) == 0 && ::fstat(descriptor, &opened) == 0 && ::stat(it.c_str(), &current) == 0 && opened.st_ino == current.st_ino)
+                {
+                    std::ifstream reader(it, std::ios::binary);
+
+                    std::string content((std::istreambuf_iterator<char>(reader)), std::istreambuf_iterator<char>());
+
+                    Entries entries;
+
+                    std::string_view cursor(content);
+
+                    bool done = false;
+                    while(!done && cursor.size() >= 12)
+                    {
+                        std::size_t size = Codec::get<std::uint32_t>(cursor);
+                        std::uint64_t sum = Codec::get<std::uint64_t>(cursor);
+
+                        if(size <= cursor.size() && size >= 4 && checksum(cursor.substr(0, size)) == sum)
+                        {
+                            std::string_view payload = cursor.substr(0, size);
+                            cursor.remove_prefix(size);
+
+                            std::size_t length = Codec::get<std::uint32_t>(payload);
+
+                            if(length <= payload.size())
+                            {
+                                entries.emplace_back(payload.substr(0, length), payload.substr(length));
+                            }
+                        }
+                        else
+                        {
+                            done = true;
+                        }
+                    }
+
+                    replay(entries);
+
+                    std::filesystem::remove(it);
+                }
+
+                ::close(descriptor);
+            }
+        }
+#endif
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Sync a file or a directory to disk, a file which
+    /// doesn't exist anymore is ignored
+    ///
+    /// \param path Path to the file or directory
+    ///
+    ////////////////////////////////////////////////////////////
+    static void persist(const std::filesystem::path& path)
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        int descriptor = ::open(path.c_str(), O_RDONLY);
+
+        if(descriptor >= 0)
+        {
+            bool synced = ::fsync(descriptor) == 0;
+
+            ::close(descriptor);
+
+            if(!synced)
+            {
+                throw std::runtime_error("Could not sync \"" + path.string() + "\"");
+            }
+        }
+#endif
+    }
+
+private:
+    ////////////////////////////////////////////////////////////
+    static constexpr std::size_t limit = 16 << 20; ///< Size of the log above which it's emptied
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Append a modification to the log, and wait until
+    /// it's on disk if every write must be durable
+    ///
+    /// \param file Path to the drawer
+    /// \param records Binary records of the modification
+    ///
+    /// \return Position of the end of the entry in the log
+    ///
+    ////////////////////////////////////////////////////////////
+    std::uint64_t log(const std::filesystem::path& file, const std::string& records)
+    {
+        std::string path = file.lexically_relative(mDirectory).generic_string();
+
+        std::string payload;
+        payload.reserve(4 + path.size() + records.size());
+
+        Codec::put<std::uint32_t>(payload, static_cast<std::uint32_t>(path.size()));
+        payload += path;
+        payload += records;
+
+        std::string frame;
+        frame.reserve(12 + payload.size());
+
+        Codec::put<std::uint32_t>(frame, static_cast<std::uint32_t>(payload.size()));
+        Codec::put<std::uint64_t>(frame, checksum(payload));
+        frame += payload;
+
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        if(!write(mDescriptor, frame))
+        {
+            throw std::runtime_error("Could not log, journal failed");
+        }
+
+        mWritten += frame.size();
+        mSize += frame.size();
+
+        std::uint64_t ticket = mWritten;
+
+        mPending.emplace(ticket, std::move(frame));
+
+        if(mDurability == Durability::Write)
+        {
+            try
+            {
+                durable(ticket, lock);
+            }
+            catch(...)
+            {
+                mPending.erase(ticket);
+                throw;
+            }
+        }
+
+        return ticket;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Mark a logged modification as applied to its drawer
+    ///
+    /// \param ticket Position of the end of the entry in the log
+    /// \param file Path to the drawer
+    ///
+    ////////////////////////////////////////////////////////////
+    void        applied(std::uint64_t ticket, const std::filesystem::path& file)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        mPending.erase(ticket);
+        mDirty.insert(file.string());
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Wait until the log is on disk up to a position,
+    /// the first waiting thread syncs for every other
+    ///
+    /// \param position Position in the log
+    /// \param lock Lock of the journal, held
+    ///
+    ////////////////////////////////////////////////////////////
+    void        durable(std::uint64_t position, std::unique_lock<std::mutex>& lock)
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        while(mSynced < position)
+        {
+            if(mSyncing)
+            {
+                mCondition.wait(lock);
+            }
+            else
+            {
+                mSyncing = true;
+
+                std::uint64_t target = mWritten;
+                int descriptor = mDescriptor;
+
+                lock.unlock();
+
+                bool synced = ::fsync(descriptor) == 0;
+
+                lock.lock();
+
+                mSyncing = false;
+
+                if(synced)
+                {
+                    mSynced = std::max(mSynced, target);
+                }
+
+                mCondition.notify_all();
+
+                if(!synced)
+                {
+                    throw std::runtime_error("Could not sync, journal failed");
+                }
+            }
+        }
+#endif
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Write bytes to a file
+    ///
+    /// \param descriptor Descriptor of the file
+    /// \param bytes Bytes to write
+    ///
+    /// \return True if every byte was written
+    ///
+    ////////////////////////////////////////////////////////////
+    static bool write(int descriptor, std::string_view bytes)
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        while(!bytes.empty())
+        {
+            ssize_t written = ::write(descriptor, bytes.data(), bytes.size());
+
+            if(written < 0 && errno != EINTR)
+            {
+                return false;
+            }
+
+            bytes.remove_prefix(written < 0 ? 0 : static_cast<std::size_t>(written));
+        }
+#endif
+
+        return true;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Compute the checksum of a frame, the FNV-1a hash
+    /// of its bytes without mixing, as logs were written
+    ///
+    /// \param bytes Bytes
+    ///
+    /// \return Checksum
+    ///
+    ////////////////////////////////////////////////////////////
+    static std::uint64_t checksum(std::string_view bytes)
+    {
+        return Codec::fnv(bytes);
+    }
+
+    ////////////////////////////////////////////////////////////
+    // Member data
+    ////////////////////////////////////////////////////////////
+    std::filesystem::path   mDirectory;     ///< Base directory of the room
+    std::filesystem::path   mFile;          ///< Path to the log
+    int                     mDescriptor;    ///< Descriptor of the log
+    Durability              mDurability;    ///< When logged modifications are synced
+    std::mutex              mMutex;         ///< Guards the journal
+    std::condition_variable mCondition;     ///< Signals the end of a sync
+    std::uint64_t           mWritten;       ///< Bytes logged since the journal started
+    std::uint64_t           mSynced;        ///< Bytes logged and on disk
+    bool                    mSyncing;       ///< True while a thread syncs the log
+    std::size_t             mSize;          ///< Size of the log
+    std::map<std::uint64_t, std::string> mPending; ///< Frames of the modifications being applied
+    std::unordered_set<std::string> mDirty;        ///< Drawers modified since the last checkpoint
+};
+
+////////////////////////////////////////////////////////////
+/// \brief True if drawers record statistics, set by defining
+/// CNROOM_STATISTICS to 1 before including the header
+///
+/// Without statistics the recording calls are discarded at
+/// compile time.
+///
+////////////////////////////////////////////////////////////
+inline constexpr bool statistics_enabled = CNROOM_STATISTICS != 0;
+
+////////////////////////////////////////////////////////////
+/// \brief Counters and latency histograms of a drawer at a
+/// point in time
+///
+////////////////////////////////////////////////////////////
+class Statistics
+{
+public:
+    ////////////////////////////////////////////////////////////
+    /// \brief Counted events
+    ///
+    ////////////////////////////////////////////////////////////
+    enum class Counter
+    {
+        Reads,          ///< Keys read
+        Writes,         ///< Keys written to the file
+        Removals,       ///< Keys removed from the file
+        Records,        ///< Records scanned while indexing or visiting the file
+        Appends,        ///< Records appended at once
+        Rewrites,       ///< Rewrites of the whole file
+        Compactions,    ///< Compactions of an appending file
+        Indexings,      ///< Indexings of the whole file
+        BytesRead,      ///< Bytes read from the file
+        BytesWritten,   ///< Bytes written to the file
+        Count           ///< Number of counters
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Timed operations
+    ///
+    ////////////////////////////////////////////////////////////
+    enum class Timer
+    {
+        Read,       ///< Reading a key
+        Write,      ///< Writing a key
+        Remove,     ///< Removing a key
+        Apply,      ///< Applying a batch
+        Scan,       ///< Visiting every key
+        Rewrite,    ///< Rewriting the file
+        Index,      ///< Indexing the file
+        Wait,       ///< Waiting for the lock of a room
+        Hold,       ///< Holding the lock of a room
+        Count       ///< Number of timers
+    };
+
+    static constexpr std::size_t counters = static_cast<std::size_t>(Counter::Count);   ///< Number of counters
+    static constexpr std::size_t timers = static_cast<std::size_t>(Timer::Count);       ///< Number of timers
+    static constexpr std::size_t bucket_count = 64;                                     ///< Number of buckets of a histogram
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Durations of an operation, bucket i counts the
+    /// durations of less than 2^i nanoseconds not counted by the
+    /// previous bucket
+    ///
+    ////////////////////////////////////////////////////////////
+    struct Histogram
+    {
+        std::array<std::uint64_t, bucket_count> buckets{};  ///< Number of durations in each bucket
+        std::uint64_t                           count = 0;  ///< Number of durations
+        std::uint64_t                           sum = 0;    ///< Sum of the durations in nanoseconds
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Estimate a quantile of the durations
+        ///
+        /// \param quantile Quantile between 0 and 1, like 0.99
+        ///
+        /// \return Upper bound of the bucket holding the quantile
+        ///
+        ////////////////////////////////////////////////////////////
+        std::chrono::nanoseconds quantile(double quantile) const
+        {
+            std::chrono::nanoseconds bound(0);
+
+            if(count > 0)
+            {
+                std::uint64_t rank = std::min(static_cast<std::uint64_t>(quantile * static_cast<double>(count)), count - 1);
+                std::uint64_t seen = 0;
+                std::size_t i = 0;
+
+                while(seen + buckets[i] <= rank)
+                {
+                    seen += buckets[i];
+                    ++i;
+                }
+
+                bound = i + 1 < bucket_count ? std::chrono::nanoseconds(std::int64_t(1) << i) : std::chrono::nanoseconds::max();
+            }
+
+            return bound;
+        }
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get a counter
+    ///
+    /// \param counter Counter
+    ///
+    /// \return Number of events
+    ///
+    ////////////////////////////////////////////////////////////
+    std::uint64_t operator [](Counter counter) const
+    {
+        return mCounters[static_cast<std::size_t>(counter)];
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the histogram of a timer
+    ///
+    /// \param timer Timer
+    ///
+    /// \return Histogram
+    ///
+    ////////////////////////////////////////////////////////////
+    const Histogram& operator [](Timer timer) const
+    {
+        return mHistograms[static_cast<std::size_t>(timer)];
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Add the statistics of another drawer
+    ///
+    /// \param other Statistics to add
+    ///
+    /// \return Statistics
+    ///
+    ////////////////////////////////////////////////////////////
+    Statistics& operator +=(const Statistics& other)
+    {
+        for(std::size_t i = 0; i < counters; ++i)
+        {
+            mCounters[i] += other.mCounters[i];
+        }
+
+        for(std::size_t i = 0; i < timers; ++i)
+        {
+            for(std::size_t j = 0; j < bucket_count; ++j)
+            {
+                mHistograms[i].buckets[j] += other.mHistograms[i].buckets[j];
+            }
+
+            mHistograms[i].count += other.mHistograms[i].count;
+            mHistograms[i].sum += other.mHistograms[i].sum;
+        }
+
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Export the statistics of drawers in the text
+    /// format of Prometheus, labelled by drawer
+    ///
+    /// Histograms are exported in seconds with a bucket every
+    /// power of 4 from about a microsecond to a minute.
+    ///
+    /// \param drawers Statistics of each drawer
+    ///
+    /// \return Text to serve to Prometheus
+    ///
+    ////////////////////////////////////////////////////////////
+    static std::string prometheus(const std::map<std::string, Statistics>& drawers)
+    {
+        static const char* const counted[counters][2] =
+        {
+            {"reads_total",             "Keys read"},
+            {"writes_total",            "Keys written to the file"},
+            {"removals_total",          "Keys removed from the file"},
+            {"records_scanned_total",   "Records scanned while indexing or visiting the file"},
+            {"appends_total",           "Records appended at once"},
+            {"rewrites_total",          "Rewrites of the whole file"},
+            {"compactions_total",       "Compactions of an appending file"},
+            {"indexings_total",         "Indexings of the whole file"},
+            {"read_bytes_total",        "Bytes read from the file"},
+            {"written_bytes_total",     "Bytes written to the file"}
+        };
+
+        static const char* const timed[timers][2] =
+        {
+            {"read_seconds",    "Duration of reading a key"},
+            {"write_seconds",   "Duration of writing a key"},
+            {"remove_seconds",  "Duration of removing a key"},
+            {"apply_seconds",   "Duration of applying a batch"},
+            {"scan_seconds",    "Duration of visiting every key"},
+            {"rewrite_seconds", "Duration of rewriting the file"},
+            {"index_seconds",   "Duration of indexing the file"},
+            {"wait_seconds",    "Duration of waiting for the lock of a room"},
+            {"hold_seconds",    "Duration of holding the lock of a room"}
+        };
+
+        auto label = [](const std::string& drawer)
+        {
+            std::string escaped;
+
+            for(char it: drawer)
+            {
+                if(it == '\\' || it == '"')
+                {
+                    escaped += '\\';
+                    escaped += it;
+                }
+                else if(it == '\n')
+                {
+                    escaped += "\\n";
+                }
+                else
+                {
+                    escaped += it;
+                }
+            }
+
+            return "drawer=\"" + escaped + "\"";
+        };
+
+        auto seconds = [](double nanoseconds)
+        {
+            char text[32];
+
+            std::snprintf(text, sizeof(text), "%.9g", nanoseconds / 1e9);
+
+            return std::string(text);
+        };
+
+        std::string text;
+
+        for(std::size_t i = 0; i < counters; ++i)
+        {
+            std::string name = std::string("cnroom_") + counted[i][0];
+
+            text += "# HELP " + name + " " + counted[i][1] + "\n";
+            text += "# TYPE " + name + " counter\n";
+
+            for(const auto& it: drawers)
+            {
+                text += name + "{" + label(it.first) + "} " + std::to_string(it.second.mCounters[i]) + "\n";
+            }
+        }
+
+        for(std::size_t i = 0; i < timers; ++i)
+        {
+            std::string name = std::string("cnroom_") + timed[i][0];
+
+            text += "# HELP " + name + " " + timed[i][1] + "\n";
+            text += "# TYPE " + name + " histogram\n";
+
+            for(const auto& it: drawers)
+            {
+                const Histogram& histogram = it.second.mHistograms[i];
+
+                std::uint64_t cumulated = 0;
+                std::size_t bucket = 0;
+
+                for(std::size_t bound = 10; bound <= 36; bound += 2)
+                {
+                    while(bucket <= bound)
+                    {
+                        cumulated += histogram.buckets[bucket++];
+                    }
+
+                    text += name + "_bucket{" + label(it.first) + ",le=\"" + seconds(static_cast<double>(std::uint64_t(1) << bound)) + "\"} " + std::to_string(cumulated) + "\n";
+                }
+
+                text += name + "_bucket{" + label(it.first) + ",le=\"+Inf\"} " + std::to_string(histogram.count) + "\n";
+                text += name + "_sum{" + label(it.first) + "} " + seconds(static_cast<double>(histogram.sum)) + "\n";
+                text += name + "_count{" + label(it.first) + "} " + std::to_string(histogram.count) + "\n";
+            }
+        }
+
+        return text;
+    }
+
+private:
+    friend class Recorder;
+
+    ////////////////////////////////////////////////////////////
+    // Member data
+    ////////////////////////////////////////////////////////////
+    std::array<std::uint64_t, counters> mCounters{};   ///< Counters
+    std::array<Histogram, timers>       mHistograms{}; ///< Histogram of each timer
+};
+
+////////////////////////////////////////////////////////////
+/// \brief Class recording the statistics of a drawer from
+/// several threads without locking
+///
+////////////////////////////////////////////////////////////
+class Recorder
+{
+public:
+    ////////////////////////////////////////////////////////////
+    /// \brief Records the duration of a scope in a timer
+    ///
+    ////////////////////////////////////////////////////////////
+    class Stopwatch
+    {
+    public:
+        ////////////////////////////////////////////////////////////
+        /// \brief Start timing
+        ///
+        /// \param recorder Recorder, nullptr to time nothing
+        /// \param timer Timer
+        ///
+        ////////////////////////////////////////////////////////////
+                    Stopwatch(Recorder* recorder, Statistics::Timer timer) : mRecorder(recorder), mTimer(timer)
+        {
+            if constexpr(statistics_enabled)
+            {
+                mStart = std::chrono::steady_clock::now();
+            }
+        }
+
+                    Stopwatch(const Stopwatch&) = delete;
+        Stopwatch&  operator =(const Stopwatch&) = delete;
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Record the duration
+        ///
+        ////////////////////////////////////////////////////////////
+                    ~Stopwatch()
+        {
+            if constexpr(statistics_enabled)
+            {
+                if(mRecorder)
+                {
+                    mRecorder->time(mTimer, std::chrono::steady_clock::now() - mStart);
+                }
+            }
+        }
+
+    private:
+        ////////////////////////////////////////////////////////////
+        // Member data
+        ////////////////////////////////////////////////////////////
+        Recorder*                               mRecorder;  ///< Recorder
+        Statistics::Timer                       mTimer;     ///< Timer
+        std::chrono::steady_clock::time_point   mStart;     ///< Time the scope started
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Count events
+    ///
+    /// \param counter Counter
+    /// \param value Number of events, 1 by default
+    ///
+    ////////////////////////////////////////////////////////////
+    void        count(Statistics::Counter counter, std::uint64_t value = 1)
+    {
+        mCounters[static_cast<std::size_t>(counter)].fetch_add(value, std::memory_order_relaxed);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Record the duration of an operation
+    ///
+    /// \param timer Timer
+    /// \param duration Duration
+    ///
+    ////////////////////////////////////////////////////////////
+    void        time(Statistics::Timer timer, std::chrono::nanoseconds duration)
+    {
+        std::uint64_t value = static_cast<std::uint64_t>(std::max<std::chrono::nanoseconds::rep>(duration.count(), 0));
+
+        std::size_t bucket = 0;
+
+        while(bucket + 1 < Statistics::bucket_count && (value >> bucket) != 0)
+        {
+            ++bucket;
+        }
+
+        Histogram& histogram = mHistograms[static_cast<std::size_t>(timer)];
+
+        histogram.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+        histogram.count.fetch_add(1, std::memory_order_relaxed);
+        histogram.sum.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the statistics recorded so far, each value is
+    /// read on its own while other threads keep recording
+    ///
+    /// \return Statistics
+    ///
+    ////////////////////////////////////////////////////////////
+    Statistics  snapshot() const
+    {
+        Statistics snapshot;
+
+        for(std::size_t i = 0; i < Statistics::counters; ++i)
+        {
+            snapshot.mCounters[i] = mCounters[i].load(std::memory_order_relaxed);
+        }
+
+        for(std::size_t i = 0; i < Statistics::timers; ++i)
+        {
+            for(std::size_t j = 0; j < Statistics::bucket_count; ++j)
+            {
+                snapshot.mHistograms[i].buckets[j] = mHistograms[i].buckets[j].load(std::memory_order_relaxed);
+            }
+
+            snapshot.mHistograms[i].count = mHistograms[i].count.load(std::memory_order_relaxed);
+            snapshot.mHistograms[i].sum = mHistograms[i].sum.load(std::memory_order_relaxed);
+        }
+
+        return snapshot;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Set every counter and histogram back to zero
+    ///
+    ////////////////////////////////////////////////////////////
+    void        reset()
+    {
+        for(auto& it: mCounters)
+        {
+            it.store(0, std::memory_order_relaxed);
+        }
+
+        for(auto& it: mHistograms)
+        {
+            for(auto& bucket: it.buckets)
+            {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+
+            it.count.store(0, std::memory_order_relaxed);
+            it.sum.store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    ////////////////////////////////////////////////////////////
+    /// \brief Histogram being recorded
+    ///
+    ////////////////////////////////////////////////////////////
+    struct Histogram
+    {
+        std::array<std::atomic<std::uint64_t>, Statistics::bucket_count> buckets{};  ///< Number of durations in each bucket
+        std::atomic<std::uint64_t>                                      count{0};   ///< Number of durations
+        std::atomic<std::uint64_t>                                      sum{0};     ///< Sum of the durations in nanoseconds
+    };
+
+    ////////////////////////////////////////////////////////////
+    // Member data
+    ////////////////////////////////////////////////////////////
+    std::array<std::atomic<std::uint64_t>, Statistics::counters>    mCounters{};    ///< Counters
+    std::array<Histogram, Statistics::timers>                       mHistograms{};  ///< Histogram of each timer
+};
+
+////////////////////////////////////////////////////////////
+/// \brief Content-addressed file holding the large strings of
+/// a drawer out of line
+///
+/// The drawer keeps a reference in place of each string, the
+/// marker followed by the hash of the content. Storing content
+/// already in the file gives the reference of the stored copy,
+/// and blobs are only appended until collect() drops the ones
+/// no longer referenced.
+///
+////////////////////////////////////////////////////////////
+class Blobs
+{
+public:
+    ////////////////////////////////////////////////////////////
+    /// \brief Open a blob file, created if it doesn't exist
+    ///
+    /// A blob left incomplete by a crash is ignored and
+    /// overwritten by the next one.
+    ///
+    /// \param file Path to the blob file
+    ///
+    ////////////////////////////////////////////////////////////
+                Blobs(const std::filesystem::path& file) : mFile(file), mEnd(0)
+    {
+        if(!std::filesystem::exists(file))
+        {
+            std::ofstream writer(file, std::ios::binary);
+            writer.write(signature().data(), static_cast<std::streamsize>(signature().size()));
+            writer.close();
+
+            if(!writer)
+            {
+                throw std::runtime_error("Failed to create blobs on \"" + file.string() + "\"");
+            }
+        }
+
+        mStream.open(file, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+
+        if(!mStream)
+        {
+            throw std::runtime_error("Failed to open blobs on \"" + file.string() + "\"");
+        }
+
+        scan();
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the marker starting every reference
+    ///
+    /// \return Marker
+    ///
+    ////////////////////////////////////////////////////////////
+    static std::string_view marker()
+    {
+        return std::string_view("\x01" "blob:", 6);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Check if a string starts with the marker, such
+    /// strings are always stored out of line so that they read
+    /// back unchanged
+    ///
+    /// \param value String
+    ///
+    /// \return True if the string is reserved
+    ///
+    ////////////////////////////////////////////////////////////
+    static bool reserved(std::string_view value)
+    {
+        return value.substr(0, marker().size()) == marker();
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the blob a string refers to
+    ///
+    /// \param value String
+    /// \param id Identifier of the blob, if the string is a
+    /// reference
+    ///
+    /// \return True if the string is a reference
+    ///
+    ////////////////////////////////////////////////////////////
+    static bool identify(std::string_view value, std::uint64_t& id)
+    {
+        bool found = false;
+
+        if(value.size() == marker().size() + 16 && reserved(value))
+        {
+            const char* first = value.data() + marker().size();
+
+            found = std::from_chars(first, first + 16, id, 16).ptr == first + 16;
+        }
+
+        return found;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Store content, unless the file already holds it
+    ///
+    /// \param content Content to store
+    ///
+    /// \return Reference to the blob
+    ///
+    ////////////////////////////////////////////////////////////
+    std::string store(std::string_view content)
+    {
+        std::lock_guard<std::mutex> lock(mReading);
+
+        std::uint64_t id = Codec::hash(content);
+        bool done = false;
+
+        while(!done)
+        {
+            auto found = mIndex.find(id);
+
+            if(found == mIndex.end())
+            {
+                std::string bytes;
+                bytes.reserve(16 + content.size());
+
+                Codec::put<std::uint64_t>(bytes, id);
+                Codec::put<std::uint64_t>(bytes, content.size());
+                bytes += content;
+
+                mStream.seekp(mEnd, mStream.beg);
+                mStream.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+                mStream.flush();
+
+                if(!mStream)
+                {
+                    mStream.clear();
+
+                    throw std::runtime_error("Could not store blob on \"" + mFile.string() + "\"");
+                }
+
+                mIndex[id] = {mEnd + 16, content.size()};
+                mEnd += static_cast<std::streamoff>(bytes.size());
+
+                done = true;
+            }
+            else if(found->second.size == content.size() && load(found->second) == content)
+            {
+                done = true;
+            }
+            else
+            {
+                ++id;
+            }
+        }
+
+        char digits[17];
+        std::snprintf(digits, sizeof(digits), "%016llx", static_cast<unsigned long long>(id));
+
+        return std::string(marker()) + std::string(digits, 16);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Replace a reference with the content of its blob,
+    /// other strings are left as they are
+    ///
+    /// \param value std::string or std::pmr::string
+    ///
+    ////////////////////////////////////////////////////////////
+    template<typename String>
+    void        resolve(String& value) const
+    {
+        std::uint64_t id = 0;
+
+        if(identify(value, id))
+        {
+            std::lock_guard<std::mutex> lock(mReading);
+
+            auto found = mIndex.find(id);
+
+            if(found == mIndex.end())
+            {
+                throw std::runtime_error("Blob " + std::string(std::string_view(value).substr(marker().size())) + " not found in \"" + mFile.string() + "\"");
+            }
+
+            value.resize(found->second.size);
+
+            mStream.seekg(found->second.offset, mStream.beg);
+            mStream.read(value.data(), static_cast<std::streamsize>(value.size()));
+
+            if(!mStream)
+            {
+                mStream.clear();
+
+                throw std::runtime_error("Could not read blob on \"" + mFile.string() + "\"");
+            }
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Rewrite the file with only the referenced blobs
+    ///
+    /// The file is replaced atomically, this object keeps
+    /// reading the previous file for the snapshots holding it.
+    ///
+    /// \param live Identifiers of the referenced blobs
+    ///
+    /// \return Blobs of the new file, or null if every blob is
+    /// referenced
+    ///
+    ////////////////////////////////////////////////////////////
+    std::shared_ptr<Blobs> collect(const std::unordered_set<std::uint64_t>& live) const
+    {
+        std::shared_ptr<Blobs> collected;
+
+        std::lock_guard<std::mutex> lock(mReading);
+
+        std::vector<std::pair<std::uint64_t, Blob>> kept;
+
+        for(const auto& it: mIndex)
+        {
+            if(live.count(it.first))
+            {
+                kept.push_back(it);
+            }
+        }
+
+        if(kept.size() < mIndex.size())
+        {
+            std::sort(kept.begin(), kept.end(), [](const auto& a, const auto& b){ return a.second.offset < b.second.offset; });
+
+            std::filesystem::path temporary = mFile.string() + ".tmp";
+
+            std::ofstream writer(temporary, std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+            writer.write(signature().data(), static_cast<std::streamsize>(signature().size()));
+
+            std::string bytes;
+
+            for(const auto& it: kept)
+            {
+                bytes.clear();
+
+                Codec::put<std::uint64_t>(bytes, it.first);
+                Codec::put<std::uint64_t>(bytes, it.second.size);
+                bytes += load(it.second);
+
+                writer.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+            }
+
+            writer.close();
+
+            if(!writer)
+            {
+                throw std::runtime_error("Could not collect blobs on \"" + temporary.string() + "\"");
+            }
+
+            Journal::persist(temporary);
+
+            std::filesystem::rename(temporary, mFile);
+
+            Journal::persist(mFile.parent_path());
+
+            collected = std::make_shared<Blobs>(mFile);
+        }
+
+        return collected;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the path of the blob file
+    ///
+    /// \return Path
+    ///
+    ////////////////////////////////////////////////////////////
+    const std::filesystem::path& path() const
+    {
+        return mFile;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the number of blobs in the file
+    ///
+    /// \return Number of blobs
+    ///
+    ////////////////////////////////////////////////////////////
+    std::size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(mReading);
+
+        return mIndex.size();
+    }
+
+private:
+    ////////////////////////////////////////////////////////////
+    /// \brief Position of a blob in the file
+    ///
+    ////////////////////////////////////////////////////////////
+    struct Blob
+    {
+        std::streamoff  offset; ///< Offset of the content
+        std::size_t     size;   ///< Size of the content
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the header of a blob file
+    ///
+    /// \return Header
+    ///
+    ////////////////////////////////////////////////////////////
+    static std::string_view signature()
+    {
+        return std::string_view("\x89" "CNB" "\x01" "\0\0\0", 8);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Index the complete blobs of the file
+    ///
+    ////////////////////////////////////////////////////////////
+    void        scan()
+    {
+        std::uintmax_t size = std::filesystem::file_size(mFile);
+
+        std::string header(signature().size(), '\0');
+        mStream.read(header.data(), static_cast<std::streamsize>(header.size()));
+
+        if(!mStream || header != signature())
+        {
+            throw std::runtime_error("Corrupted blobs \"" + mFile.string() + "\"");
+        }
+
+        mEnd = static_cast<std::streamoff>(header.size());
+
+        std::string entry(16, '\0');
+        bool done = false;
+
+        while(!done)
+        {
+            mStream.seekg(mEnd, mStream.beg);
+            mStream.read(entry.data(), static_cast<std::streamsize>(entry.size()));
+
+            if(mStream)
+            {
+                std::string_view cursor(entry);
+
+                std::uint64_t id = Codec::get<std::uint64_t>(cursor);
+                std::uint64_t length = Codec::get<std::uint64_t>(cursor);
+
+                if(length <= size - static_cast<std::uintmax_t>(mEnd) - 16)
+                {
+                    mIndex[id] = {mEnd + 16, static_cast<std::size_t>(length)};
+                    mEnd += static_cast<std::streamoff>(16 + length);
+                }
+                else
+                {
+                    done = true;
+                }
+            }
+            else
+            {
+                done = true;
+            }
+        }
+
+        mStream.clear();
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Read the content of a blob, the lock must be held
+    ///
+    /// \param blob Position of the blob
+    ///
+    /// \return Content
+    ///
+    ////////////////////////////////////////////////////////////
+    std::string load(const Blob& blob) const
+    {
+        std::string content(blob.size, '\0');
+
+        mStream.seekg(blob.offset, mStream.beg);
+        mStream.read(content.data(), static_cast<std::streamsize>(content.size()));
+
+        if(!mStream)
+        {
+            mStream.clear();
+
+            throw std::runtime_error("Could not read blob on \"" + mFile.string() + "\"");
+        }
+
+        return content;
+    }
+
+    ////////////////////////////////////////////////////////////
+    // Member data
+    ////////////////////////////////////////////////////////////
+    std::filesystem::path   mFile;      ///< Path to the blob file
+    mutable std::fstream    mStream;    ///< Stream
+    mutable std::mutex      mReading;   ///< Lock of the stream between threads
+    std::unordered_map<std::uint64_t, Blob> mIndex; ///< Position of each blob by identifier
+    std::streamoff          mEnd;       ///< End of the last complete blob
+};
+
+////////////////////////////////////////////////////////////
+/// \brief Stream class to operate files
+///
+////////////////////////////////////////////////////////////
+class Stream
+{
+public:
+    ////////////////////////////////////////////////////////////
+    /// \brief Ways to store modifications in the file
+    ///
+    ////////////////////////////////////////////////////////////
+    enum class Mode
+    {
+        Rewrite,    ///< Rewrite the file on each modification
+        Append      ///< Append modifications, the last record of a key wins, a compressed file is rewritten
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Kinds of secondary indexes
+    ///
+    ////////////////////////////////////////////////////////////
+    enum class Lookup
+    {
+        Hash,       ///< Find keys by the exact value
+        Ordered     ///< Find keys by a range of int or double values, other values aren't indexed
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Iterator over the keys of the stream in the order
+    /// of their names, a key is read when dereferenced
+    ///
+    /// Modifying the stream invalidates the iterators.
+    ///
+    ////////////////////////////////////////////////////////////
+    class Iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = Key;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = const Key*;
+        using reference         = const Key&;
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Construct an iterator on no stream
+        ///
+        ////////////////////////////////////////////////////////////
+                    Iterator() : mStream(nullptr), mPosition(0), mLoaded(false)
+        {
+
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Construct an iterator on a key of a stream
+        ///
+        /// \param stream Stream
+        /// \param position Position of the key in the order
+        ///
+        ////////////////////////////////////////////////////////////
+                    Iterator(const Stream* stream, std::size_t position) : mStream(stream), mPosition(position), mLoaded(false)
+        {
+
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Get the name of the key without reading it
+        ///
+        /// \return Name of the key
+        ///
+        ////////////////////////////////////////////////////////////
+        const std::string& name() const
+        {
+            return mStream->mOrder[mPosition]->first;
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Read the key
+        ///
+        /// \return Key
+        ///
+        ////////////////////////////////////////////////////////////
+        const Key&  operator *() const
+        {
+            if(!mLoaded)
+            {
+                mKey.name = name();
+                mKey.values.clear();
+
+                mStream->decode(mStream->mOrder[mPosition]->second, mKey);
+
+                mLoaded = true;
+            }
+
+            return mKey;
+        }
+
+        ////////////////////////////////////////////////////////////
+        const Key*  operator ->() const
+        {
+            return &**this;
+        }
+
+        ////////////////////////////////////////////////////////////
+        Iterator&   operator ++()
+        {
+            ++mPosition;
+            mLoaded = false;
+
+            return *this;
+        }
+
+        ////////////////////////////////////////////////////////////
+        Iterator    operator ++(int)
+        {
+            Iterator previous(mStream, mPosition);
+
+            ++*this;
+
+            return previous;
+        }
+
+        ////////////////////////////////////////////////////////////
+        bool        operator ==(const Iterator& other) const
+        {
+            return mStream == other.mStream && mPosition == other.mPosition;
+        }
+
+        ////////////////////////////////////////////////////////////
+        bool        operator !=(const Iterator& other) const
+        {
+            return !(*this == other);
+        }
+
+    private:
+        ////////////////////////////////////////////////////////////
+        // Member data
+        ////////////////////////////////////////////////////////////
+        const Stream*   mStream;    ///< Stream
+        std::size_t     mPosition;  ///< Position of the key in the order
+        mutable Key     mKey;       ///< Key, once read
+        mutable bool    mLoaded;    ///< True if the key was read
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Keys between two iterators
+    ///
+    ////////////////////////////////////////////////////////////
+    class Range
+    {
+    public:
+        ////////////////////////////////////////////////////////////
+        /// \brief Construct a range
+        ///
+        /// \param first First key
+        /// \param last Key past the last one
+        ///
+        ////////////////////////////////////////////////////////////
+                    Range(Iterator first, Iterator last) : mFirst(first), mLast(last)
+        {
+
+        }
+
+        ////////////////////////////////////////////////////////////
+        Iterator    begin() const
+        {
+            return mFirst;
+        }
+
+        ////////////////////////////////////////////////////////////
+        Iterator    end() const
+        {
+            return mLast;
+        }
+
+        ////////////////////////////////////////////////////////////
+        bool        empty() const
+        {
+            return mFirst == mLast;
+        }
+
+    private:
+        ////////////////////////////////////////////////////////////
+        // Member data
+        ////////////////////////////////////////////////////////////
+        Iterator    mFirst; ///< First key
+        Iterator    mLast;  ///< Key past the last one
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Construct an empty stream
+    ///
+    ////////////////////////////////////////////////////////////
+                Stream() : mFile(""), mLines(0), mTerminated(true), mMode(Mode::Rewrite), mThreshold(0.5), mOutline(0), mTransaction(false), mEncoding(Encoding::Text), mOrdered(false), mRecorder(statistics_enabled ? std::make_shared<Recorder>() : nullptr), mCached(-1), mComplete(true)
+    {
+
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Construct a stream ready to be operate on
+    ///
+    /// \param file Path to the file to operate
+    /// \param create Create new if file doesn't exist, false by
+    /// default
+    /// \param mode Way to store modifications, Mode::Rewrite by
+    /// default
+    ///
+    ////////////////////////////////////////////////////////////
+                Stream(const std::filesystem::path& file, bool create = false, Mode mode = Mode::Rewrite) : mFile(file), mLines(0), mTerminated(true), mMode(mode), mThreshold(0.5), mOutline(0), mTransaction(false), mEncoding(Encoding::Text), mOrdered(false), mRecorder(statistics_enabled ? std::make_shared<Recorder>() : nullptr), mCached(-1), mComplete(true)
+    {
+        open(file, create);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Default destructor, discards a transaction that
+    /// wasn't committed
+    ///
+    ////////////////////////////////////////////////////////////
+                ~Stream()
+    {
+        if(mStream)
+        {
+            if(!mSecondary.empty())
+            {
+                try
+                {
+                    persist_indexes();
+                }
+                catch(const std::exception&)
+                {
+
+                }
+            }
+
+            mStream.close();
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Open a file to operate on, its encoding is
+    /// detected
+    ///
+    /// \param file Path to the file to operate
+    /// \param create Create new if file doesn't exist, false by
+    /// default
+    ///
+    ////////////////////////////////////////////////////////////
+    void        open(const std::filesystem::path& file, bool create = false)
+    {
+        bool exists = true;
+
+        mFile = file;
+
+        if(!std::filesystem::exists(file))
+        {
+            if(create)
+            {
+                std::ofstream writer(file, std::ios_base::app);
+
+                if(!writer && file.string().size() > file.filename().string().size())
+                {
+                    std::filesystem::create_directories(file.string().substr(0, file.string().size() - file.filename().string().size()));
+                    writer.open(file, std::ios_base::app);
+                }
+
+                if(writer)
+                {
+                    writer.close();
+                }
+                else
+                {
+                    exists = false;
+                    throw std::runtime_error("Stream failed to create file on \"" + file.string() + "\"");
+                }
+            }
+            else
+            {
+                exists = false;
+                throw std::runtime_error("Path \"" + file.string() + "\" doesn't point to any file");
+            }
+        }
+
+        if(exists)
+        {
+            mStream.open(file, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+
+            if(!mStream)
+            {
+                throw std::runtime_error("Stream failed to open file on \"" + file.string() + "\"");
+            }
+
+            if(!load())
+            {
+                index();
+            }
+
+            load_indexes();
+
+            std::filesystem::path blobs = mFile.parent_path() / ".cnroom" / (mFile.filename().string() + ".blb");
+
+            mBlobs = std::filesystem::exists(blobs) ? std::make_shared<Blobs>(blobs) : nullptr;
+        }
+    }
+
+    ///////////////////////////////////////////////////////////
+    /// \brief Overload of operator << to write to the file
+    ///
+    ////////////////////////////////////////////////////////////
+    Stream&     operator <<(Key key)
+    {
+        write(key);
+        return *this;
+    }
+
+    ///////////////////////////////////////////////////////////
+    /// \brief Overload of operator >> to read from a file
+    ///
+    ////////////////////////////////////////////////////////////
+    Stream&     operator >>(const std::string& name)
+    {
+        mKey = read(name);
+        return *this;
+    }
+
+    ///////////////////////////////////////////////////////////
+    /// \brief Overload of operator () to access internal key
+    ///
+    /// \return Internal key
+    ///
+    ////////////////////////////////////////////////////////////
+    Key&        operator ()()
+    {
+        return mKey;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Set the way modifications are stored
+    ///
+    /// \param mode Mode::Append to append modifications instead
+    /// of rewriting the file
+    ///
+    ////////////////////////////////////////////////////////////
+    void        set_mode(Mode mode)
+    {
+        mMode = mode;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Set the ratio of dead records above which an
+    /// appending stream compacts the file, 0.5 by default
+    ///
+    /// \param threshold Ratio between 0 and 1
+    ///
+    ////////////////////////////////////////////////////////////
+    void        set_compaction_threshold(double threshold)
+    {
+        mThreshold = threshold;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Set the size above which strings are written to a
+    /// blob file beside the drawer, the drawer keeping a small
+    /// reference read back on demand
+    ///
+    /// Strings starting with the blob marker are always stored
+    /// as blobs, so that they read back unchanged.
+    ///
+    /// \param bytes Size in bytes, 0 by default to keep every
+    /// string in the drawer
+    ///
+    ////////////////////////////////////////////////////////////
+    void        set_blob_threshold(std::size_t bytes)
+    {
+        mOutline = bytes;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Open the file again and rebuild the index, after
+    /// the file was modified by another stream
+    ///
+    ////////////////////////////////////////////////////////////
+    void        reload()
+    {
+        mStream.close();
+        mStream.clear();
+
+        open(mFile);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the encoding of the file
+    ///
+    /// \return Encoding
+    ///
+    ////////////////////////////////////////////////////////////
+    Encoding    encoding() const
+    {
+        return mEncoding;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the number of keys in the file
+    ///
+    /// \return Number of keys
+    ///
+    ////////////////////////////////////////////////////////////
+    std::size_t size() const
+    {
+        complete();
+
+        return mIndex.size();
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the statistics of the stream, empty unless
+    /// CNROOM_STATISTICS is defined to 1
+    ///
+    /// \return Counters and latency histograms
+    ///
+    ////////////////////////////////////////////////////////////
+    Statistics  statistics() const
+    {
+        Statistics snapshot;
+
+        if constexpr(statistics_enabled)
+        {
+            snapshot = mRecorder->snapshot();
+        }
+
+        return snapshot;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Set the statistics of the stream back to zero
+    ///
+    ////////////////////////////////////////////////////////////
+    void        reset_statistics()
+    {
+        if constexpr(statistics_enabled)
+        {
+            mRecorder->reset();
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Rewrite the file with only the last record of
+    /// each key, dropping overwritten records and removals
+    ///
+    ////////////////////////////////////////////////////////////
+    void        compact()
+    {
+        if(mStream)
+        {
+            count(Statistics::Counter::Compactions);
+
+            rewrite(WriteBatch(), mEncoding);
+
+            collect_blobs();
+        }
+        else
+        {
+            throw std::runtime_error("Could not compact, stream failed");
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Drop the blobs that no key refers to anymore, done
+    /// by compact() as well
+    ///
+    /// Only the records holding a reference are decoded.
+    ///
+    ////////////////////////////////////////////////////////////
+    void        collect_blobs()
+    {
+        if(!mStream)
+        {
+            throw std::runtime_error("Could not collect blobs, stream failed");
+        }
+
+        complete();
+
+        if(mBlobs)
+        {
+            std::vector<const Location*> live;
+            live.reserve(mIndex.size());
+
+            for(const auto& it: mIndex)
+            {
+                live.push_back(&it.second);
+            }
+
+            std::sort(live.begin(), live.end(), [](const Location* a, const Location* b){ return a->offset < b->offset || (a->offset == b->offset && a->position < b->position); });
+
+            std::string content = mEncoding != Encoding::Compressed ? contents() : std::string();
+
+            std::unordered_set<std::uint64_t> referenced;
+
+            std::string raw;
+            std::streamoff block = -1;
+
+            Key key;
+            Codec::Record record;
+            for(const auto& it: live)
+            {
+                std::string_view bytes;
+
+                if(mEncoding == Encoding::Compressed)
+                {
+                    if(block != it->offset)
+                    {
+                        unpack(mStream, it->offset, raw);
+
+                        block = it->offset;
+                    }
+
+                    bytes = std::string_view(raw).substr(it->position, it->length);
+                }
+                else
+                {
+                    bytes = std::string_view(content).substr(static_cast<std::size_t>(it->offset), it->length);
+                }
+
+                if(bytes.find(Blobs::marker()) != std::string_view::npos && Codec::next(bytes, 0, mEncoding, record))
+                {
+                    key.values.clear();
+
+                    Codec::parse(record.values, mEncoding, key);
+
+                    std::uint64_t id = 0;
+
+                    for(const auto& value: key.values)
+                    {
+                        const std::string* string = std::get_if<std::string>(&value);
+
+                        if(string && Blobs::identify(*string, id))
+                        {
+                            referenced.insert(id);
+                        }
+                    }
+                }
+            }
+
+            std::shared_ptr<Blobs> collected = mBlobs->collect(referenced);
+
+            if(collected)
+            {
+                mBlobs = collected;
+            }
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Rewrite the file in another encoding
+    ///
+    /// \param encoding Encoding to convert to
+    ///
+    ////////////////////////////////////////////////////////////
+    void        convert(Encoding encoding)
+    {
+        if(mStream)
+        {
+            rewrite(WriteBatch(), encoding);
+        }
+        else
+        {
+            throw std::runtime_error("Could not convert, stream failed");
+        }
+    }
+
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Start a transaction, writes and removals are kept
+    /// in memory until commit() applies them at once
+    ///
+    ////////////////////////////////////////////////////////////
+    void        begin()
+    {
+        if(mTransaction)
+        {
+            throw std::runtime_error("Could not begin, a transaction is already in progress");
+        }
+
+        mTransaction = true;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Apply the writes and removals of the transaction
+    ///
+    ////////////////////////////////////////////////////////////
+    void        commit()
+    {
+        if(!mTransaction)
+        {
+            throw std::runtime_error("Could not commit, no transaction in progress");
+        }
+
+        mTransaction = false;
+
+        WriteBatch batch = std::move(mBatch);
+        mBatch.clear();
+
+        apply(batch);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Discard the writes and removals of the transaction
+    ///
+    ////////////////////////////////////////////////////////////
+    void        rollback()
+    {
+        mTransaction = false;
+
+        mBatch.clear();
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Apply a batch of writes and removals, a rewriting
+    /// stream rewrites the file once and replaces it atomically
+    ///
+    /// \param batch Operations to apply
+    ///
+    ////////////////////////////////////////////////////////////
+    void        apply(const WriteBatch& batch)
+    {
+        Recorder::Stopwatch stopwatch(mRecorder.get(), Statistics::Timer::Apply);
+
+        complete();
+
+        if(mStream)
+        {
+            if(mTransaction)
+            {
+                for(const auto& it: batch.mOperations)
+                {
+                    mBatch.set(it.first, it.second);
+                }
+            }
+            else if(mMode == Mode::Append && mEncoding != Encoding::Compressed)
+            {
+                WriteBatch outlined;
+                const WriteBatch& stored = outline(batch, outlined) ? outlined : batch;
+
+                Journal::Entry entry(mJournal, mFile, stored);
+
+                std::string records;
+                std::size_t count = 0;
+
+                std::vector<std::pair<const std::string*, std::optional<Location>>> positions;
+
+                for(const auto& it: stored.mOperations)
+                {
+                    if(it.second)
+                    {
+                        std::string record = Codec::record(*it.second, mEncoding);
+
+                        positions.emplace_back(&it.first, Location{static_cast<std::streamoff>(records.size()), record.size()});
+
+                        records += record;
+                        ++count;
+                    }
+                    else if(mIndex.count(it.first))
+                    {
+                        positions.emplace_back(&it.first, std::nullopt);
+
+                        records += Codec::tombstone(it.first, mEncoding);
+                        ++count;
+                    }
+                }
+
+                std::streamoff offset = append(records, count);
+
+                tally(batch);
+                track(batch);
+
+                for(const auto& it: positions)
+                {
+                    if(it.second)
+                    {
+                        mIndex[*it.first] = {offset + it.second->offset, it.second->length};
+                    }
+                    else
+                    {
+                        mIndex.erase(*it.first);
+                    }
+                }
+
+                collect();
+            }
+            else
+            {
+                WriteBatch outlined;
+                const WriteBatch& stored = outline(batch, outlined) ? outlined : batch;
+
+                Journal::Entry entry(mJournal, mFile, stored);
+
+                rewrite(stored, mEncoding);
+
+                tally(batch);
+                track(batch);
+            }
+        }
+        else
+        {
+            throw std::runtime_error("Could not apply, stream failed");
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Write a key to the stream
+    ///
+    /// \param key Key to write
+    ///
+    ////////////////////////////////////////////////////////////
+    void        write(const Key& key)
+    {
+        Recorder::Stopwatch stopwatch(mRecorder.get(), Statistics::Timer::Write);
+
+        complete();
+
+        if(mStream)
+        {
+            if(mTransaction)
+            {
+                mBatch.write(key);
+            }
+            else if(mMode == Mode::Append && mEncoding != Encoding::Compressed)
+            {
+                Key outlined;
+                const Key& stored = outline(key, outlined) ? outlined : key;
+
+                Journal::Entry entry(mJournal, mFile, stored);
+
+                std::string record = Codec::record(stored, mEncoding);
+
+                mIndex[key.name] = {append(record, 1), record.size()};
+
+                count(Statistics::Counter::Writes);
+                track(key.name, &key);
+
+                collect();
+            }
+            else
+            {
+                Key outlined;
+
+                WriteBatch batch;
+                batch.write(outline(key, outlined) ? outlined : key);
+
+                Journal::Entry entry(mJournal, mFile, batch);
+
+                rewrite(batch, mEncoding);
+
+                count(Statistics::Counter::Writes);
+                track(key.name, &key);
+            }
+        }
+        else
+        {
+            throw std::runtime_error("Could not write, stream failed");
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Replace a value of a key
+    ///
+    /// An int, double or bool replacing a value of the same type
+    /// in a binary file is written over the old one, unless a
+    /// snapshot or a mapped drawer of a room holds the file.
+    /// Otherwise the key is written again by write(): appended by
+    /// an appending stream, but a rewriting stream or a compressed
+    /// file rewrites the whole file, as write() does.
+    ///
+    /// \param name Name of the key, must exist
+    /// \param index Position of the value, must exist
+    /// \param value New value
+    ///
+    ////////////////////////////////////////////////////////////
+    void        update(const std::string& name, std::size_t index, const Types& value)
+    {
+        Key key = read(name);
+
+        if(index >= key.values.size())
+        {
+            throw std::runtime_error("Could not update, key \"" + name + "\" has no value " + std::to_string(index));
+        }
+
+        key.values[index] = value;
+
+        if(!overwrite(key, index))
+        {
+            write(key);
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Add a value at the end of a key, the key is
+    /// written again
+    ///
+    /// \param name Name of the key, created if it doesn't exist
+    /// \param value Value to add
+    ///
+    ////////////////////////////////////////////////////////////
+    void        append_value(const std::string& name, const Types& value)
+    {
+        Key key = read(name);
+
+        key.values.push_back(value);
+
+        write(key);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Add to an int or double value of a key, in place
+    /// like update()
+    ///
+    /// The key is read and written in one call, a room makes it
+    /// atomic by holding the drawer for writing. When the value
+    /// can't be written in place the whole file may be rewritten,
+    /// as by update(). An int that would overflow throws and the
+    /// key is left unchanged.
+    ///
+    /// \param name Name of the key, must exist
+    /// \param index Position of the value, must be of the type of
+    /// the delta
+    /// \param delta int or double to add
+    ///
+    /// \return New value
+    ///
+    ////////////////////////////////////////////////////////////
+    template<typename T>
+    T           increment(const std::string& name, std::size_t index, T delta)
+    {
+        static_assert(std::is_same_v<T, int> || std::is_same_v<T, double>, "Only int and double values can be incremented");
+
+        Key key = read(name);
+
+        T* value = index < key.values.size() ? std::get_if<T>(&key.values[index]) : nullptr;
+
+        if(!value)
+        {
+            throw std::runtime_error("Could not increment, key \"" + name + "\" has no " + (std::is_same_v<T, int> ? "int" : "double") + " value " + std::to_string(index));
+        }
+
+        if constexpr(std::is_same_v<T, int>)
+        {
+            if(delta > 0 ? *value > std::numeric_limits<int>::max() - delta : *value < std::numeric_limits<int>::min() - delta)
+            {
+                throw std::runtime_error("Could not increment, value " + std::to_string(index) + " of key \"" + name + "\" would overflow");
+            }
+        }
+
+        *value += delta;
+
+        if(!overwrite(key, index))
+        {
+            write(key);
+        }
+
+        return *value;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Read a key from the stream, several threads may
+    /// read at once as long as none of them modifies the stream
+    ///
+    /// \param name Name of the key to read
+    ///
+    /// \return Key
+    ///
+    ////////////////////////////////////////////////////////////
+    Key     read(const std::string& name) const
+    {
+        Key key{name, {}};
+
+        fill(name, key);
+
+        return key;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Read a key from the stream, allocating its name,
+    /// values and strings from a memory resource
+    ///
+    /// Backing the keys of a request with a pmr::Arena replaces
+    /// their allocations with a few large ones, released at once.
+    ///
+    /// \param name Name of the key to read
+    /// \param resource Memory resource, must outlive the key
+    ///
+    /// \return Key
+    ///
+    ////////////////////////////////////////////////////////////
+    pmr::Key read(const std::string& name, std::pmr::memory_resource* resource) const
+    {
+        pmr::Key key(name, resource);
+
+        fill(name, key);
+
+        return key;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Read several keys from the stream in one pass over
+    /// the file
+    ///
+    /// Records are read in the order of the file, records close
+    /// to each other in a single read. The keys of a compressed
+    /// file are read in the order of their names, which is the
+    /// order of the file, so each block is decompressed once.
+    ///
+    /// \param names Names of the keys to read
+    ///
+    /// \return Keys in the order of the names, without values for
+    /// the names that don't exist
+    ///
+    ////////////////////////////////////////////////////////////
+    std::vector<Key> read_many(const std::vector<std::string>& names) const
+    {
+        const std::streamoff gap = 4096;
+
+        Recorder::Stopwatch stopwatch(mRecorder.get(), Statistics::Timer::Read);
+
+        std::vector<Key> keys;
+        keys.reserve(names.size());
+
+        std::vector<std::size_t> order;
+        order.reserve(names.size());
+
+        for(std::size_t i = 0; i < names.size(); ++i)
+        {
+            keys.push_back(Key{names[i], {}});
+            order.push_back(i);
+        }
+
+        if(mEncoding == Encoding::Compressed)
+        {
+            std::sort(order.begin(), order.end(), [&names](std::size_t a, std::size_t b){ return names[a] < names[b]; });
+        }
+
+        std::vector<std::pair<Location, std::size_t>> located;
+
+        for(std::size_t i: order)
+        {
+            const WriteBatch::Operation* pending = mTransaction ? mBatch.find(names[i]) : nullptr;
+
+            Location location;
+
+            if(pending)
+            {
+                if(pending->second)
+                {
+                    keys[i].values = pending->second->values;
+                }
+            }
+            else if(locate(names[i], location))
+            {
+                if(mEncoding == Encoding::Compressed)
+                {
+                    decode(location, keys[i]);
+                }
+                else
+                {
+                    located.emplace_back(location, i);
+                }
+            }
+        }
+
+        std::sort(located.begin(), located.end(), [](const auto& a, const auto& b){ return a.first.offset < b.first.offset || (a.first.offset == b.first.offset && a.first.position < b.first.position); });
+
+        std::string buffer;
+        Codec::Record record;
+
+        std::size_t i = 0;
+        while(i < located.size())
+        {
+            std::streamoff begin = located[i].first.offset;
+            std::streamoff end = begin + static_cast<std::streamoff>(located[i].first.length);
+
+            std::size_t last = i + 1;
+
+            while(last < located.size() && located[last].first.offset <= end + gap)
+            {
+                end = std::max(end, located[last].first.offset + static_cast<std::streamoff>(located[last].first.length));
+
+                ++last;
+            }
+
+            fetch(Location{begin, static_cast<std::size_t>(end - begin)}, buffer);
+
+            for(; i < last; ++i)
+            {
+                std::string_view bytes = std::string_view(buffer).substr(static_cast<std::size_t>(located[i].first.offset - begin), located[i].first.length);
+
+                if(Codec::next(bytes, 0, mEncoding, record))
+                {
+                    Codec::parse(record.values, mEncoding, keys[located[i].second]);
+
+                    expand(keys[located[i].second]);
+                }
+            }
+        }
+
+        count(Statistics::Counter::Reads, names.size());
+
+        return keys;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the keys from the first one whose name isn't
+    /// less than a name, in the order of their names
+    ///
+    /// Ranges only see the keys written in the file, not the
+    /// writes of a transaction in progress.
+    ///
+    /// \param name Name to start from
+    ///
+    /// \return Keys
+    ///
+    ////////////////////////////////////////////////////////////
+    Range       lower_bound(const std::string& name) const
+    {
+        const Order& order = ordered();
+
+        return Range(Iterator(this, bound(name)), Iterator(this, order.size()));
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the keys whose names are between two names, in
+    /// the order of their names
+    ///
+    /// \param first Name of the first key, included
+    /// \param last Name of the last key, excluded
+    ///
+    /// \return Keys
+    ///
+    ////////////////////////////////////////////////////////////
+    Range       range(const std::string& first, const std::string& last) const
+    {
+        ordered();
+
+        std::size_t begin = bound(first);
+
+        return Range(Iterator(this, begin), Iterator(this, std::max(begin, bound(last))));
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the keys whose names start with a prefix, in
+    /// the order of their names
+    ///
+    /// \param prefix Beginning of the names, like "user:123:"
+    ///
+    /// \return Keys
+    ///
+    ////////////////////////////////////////////////////////////
+    Range       prefix(const std::string& prefix) const
+    {
+        const Order& order = ordered();
+
+        auto first = order.begin() + static_cast<std::ptrdiff_t>(bound(prefix));
+
+        auto last = std::partition_point(first, order.end(), [&prefix](const Index::value_type* it)
+        {
+            return it->first.compare(0, prefix.size(), prefix) == 0;
+        });
+
+        return Range(Iterator(this, static_cast<std::size_t>(first - order.begin())), Iterator(this, static_cast<std::size_t>(last - order.begin())));
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Visit every key of the stream in one pass over the
+    /// file, in the order of the file, followed by the writes of
+    /// the transaction
+    ///
+    /// The file is read through its own handle, the visitor may
+    /// read the stream.
+    ///
+    /// \param visitor Function called with each key, returns
+    /// false to stop
+    ///
+    /// \return True if every key was visited
+    ///
+    ////////////////////////////////////////////////////////////
+    bool        for_each(const std::function<bool(const Key&)>& visitor) const
+    {
+        return visit(visitor);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Remove a key in the stream
+    ///
+    /// \param name Name of the key to delete
+    ///
+    ////////////////////////////////////////////////////////////
+    void  remove(const std::string& name)
+    {
+        Recorder::Stopwatch stopwatch(mRecorder.get(), Statistics::Timer::Remove);
+
+        complete();
+
+        if(mStream)
+        {
+            if(mTransaction)
+            {
+                mBatch.remove(name);
+            }
+            else if(mIndex.count(name))
+            {
+                if(mMode == Mode::Append && mEncoding != Encoding::Compressed)
+                {
+                    Journal::Entry entry(mJournal, mFile, name);
+
+                    append(Codec::tombstone(name, mEncoding), 1);
+
+                    mIndex.erase(name);
+
+                    count(Statistics::Counter::Removals);
+                    track(name, nullptr);
+
+                    collect();
+                }
+                else
+                {
+                    WriteBatch batch;
+                    batch.remove(name);
+
+                    Journal::Entry entry(mJournal, mFile, batch);
+
+                    rewrite(batch, mEncoding);
+
+                    count(Statistics::Counter::Removals);
+                    track(name, nullptr);
+                }
+            }
+        }
+        else
+        {
+            throw std::runtime_error("Could not remove, stream failed");
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Remove several keys in the stream, the file is
+    /// rewritten or appended to at most once
+    ///
+    /// \param names Names of the keys to delete
+    ///
+    ////////////////////////////////////////////////////////////
+    void        remove_many(const std::vector<std::string>& names)
+    {
+        complete();
+
+        if(mStream)
+        {
+            WriteBatch batch;
+
+            for(const auto& it: names)
+            {
+                if(mTransaction || mIndex.count(it))
+                {
+                    batch.remove(it);
+                }
+            }
+
+            if(!batch.empty())
+            {
+                apply(batch);
+            }
+        }
+        else
+        {
+            throw std::runtime_error("Could not remove, stream failed");
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Index the keys by one of their values, the index
+    /// is kept up to date by the modifications of the stream
+    ///
+    /// Indexes are persisted beside the file, in the hidden
+    /// .cnroom directory of its parent, and rebuilt when opening
+    /// a file modified by another stream. Keys without the value
+    /// aren't indexed.
+    ///
+    /// \param value Position of the value in the keys
+    /// \param lookup Lookup::Hash to find keys by value, or
+    /// Lookup::Ordered to find them by a range of numbers
+    ///
+    ////////////////////////////////////////////////////////////
+    void        add_index(std::size_t value, Lookup lookup)
+    {
+        if(!mStream)
+        {
+            throw std::runtime_error("Could not add index, stream failed");
+        }
+
+        if(mTransaction)
+        {
+            throw std::runtime_error("Could not add index, a transaction is in progress");
+        }
+
+        auto found = mSecondary.find(value);
+
+        if(found == mSecondary.end() || found->second.lookup != lookup)
+        {
+            mSecondary[value] = Secondary{lookup, {}, {}, {}};
+
+            populate(value, mSecondary[value]);
+
+            persist_indexes();
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Remove the index of a value
+    ///
+    /// \param value Position of the value in the keys
+    ///
+    ////////////////////////////////////////////////////////////
+    void        drop_index(std::size_t value)
+    {
+        if(mSecondary.erase(value))
+        {
+            if(mSecondary.empty())
+            {
+                std::filesystem::remove(sidecar(mFile, ".sdx"));
+            }
+            else
+            {
+                persist_indexes();
+            }
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Find the keys whose value equals a value through
+    /// its index, only the matching records are read
+    ///
+    /// Indexes see the keys written in the file, not the writes
+    /// of a transaction in progress.
+    ///
+    /// \param value Position of the value in the keys, must be
+    /// indexed
+    /// \param equal Value to find, an ordered index compares
+    /// numbers
+    ///
+    /// \return Keys in the order of their names, or of their
+    /// values for an ordered index
+    ///
+    ////////////////////////////////////////////////////////////
+    std::vector<Key> find_by(std::size_t value, const Types& equal) const
+    {
+        const Secondary& secondary = indexed(value);
+
+        std::vector<std::string> names;
+
+        if(secondary.lookup == Lookup::Hash)
+        {
+            auto found = secondary.hashed.find(token(equal));
+
+            if(found != secondary.hashed.end())
+            {
+                names.assign(found->second.begin(), found->second.end());
+            }
+        }
+        else if(std::optional<double> number = numeric(equal))
+        {
+            auto range = secondary.ordered.equal_range(*number);
+
+            for(auto it = range.first; it != range.second; ++it)
+            {
+                names.push_back(it->second);
+            }
+        }
+
+        return matching(names);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Find the keys whose value is a number within a
+    /// range through its ordered index, only the matching records
+    /// are read
+    ///
+    /// \param value Position of the value in the keys, must have
+    /// an ordered index
+    /// \param low Lowest number, included
+    /// \param high Highest number, included
+    ///
+    /// \return Keys in the order of their values
+    ///
+    ////////////////////////////////////////////////////////////
+    std::vector<Key> find_by(std::size_t value, double low, double high) const
+    {
+        const Secondary& secondary = indexed(value);
+
+        if(secondary.lookup != Lookup::Ordered)
+        {
+            throw std::runtime_error("Could not find, the index of value " + std::to_string(value) + " isn't ordered");
+        }
+
+        std::vector<std::string> names;
+
+        for(auto it = secondary.ordered.lower_bound(low); it != secondary.ordered.end() && it->first <= high; ++it)
+        {
+            names.push_back(it->second);
+        }
+
+        return matching(names);
+    }
+
+private:
+    friend class Room;
+    friend class ShardedDrawer;
+    friend class Snapshot;
+
+    template<typename... Ts>
+    friend class TypedStream;
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Position of a key in the file
+    ///
+    ////////////////////////////////////////////////////////////
+    struct Location
+    {
+        std::streamoff  offset;         ///< Offset of the record in the file, or of its block in a compressed file
+        std::size_t     length;         ///< Length of the record, line break or length included
+        std::size_t     position = 0;   ///< Offset of the record in its block, in a compressed file
+    };
+
+    ////////////////////////////////////////////////////////////
+    using Index = std::unordered_map<std::string, Location>; ///< Position of each key
+    using Order = std::vector<const Index::value_type*>;     ///< Keys in the order of their names
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Secondary index of a value of the keys
+    ///
+    ////////////////////////////////////////////////////////////
+    struct Secondary
+    {
+        Lookup                                                  lookup;     ///< Kind of index
+        std::unordered_map<std::string, Types>                  values;     ///< Indexed value of each key
+        std::unordered_map<std::string, std::set<std::string>>  hashed;     ///< Keys by encoded value, if Lookup::Hash
+        std::multimap<double, std::string>                      ordered;    ///< Keys by number, if Lookup::Ordered
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Detect the encoding and store the position of
+    /// every key, the last record of a key wins and a removal
+    /// record removes the key
+    ///
+    /// The file is read in large chunks and records are found
+    /// in place, without a copy per line. Only the index of the
+    /// blocks of a compressed file is read, its keys are found
+    /// block by block until complete() indexes them all.
+    ///
+    ////////////////////////////////////////////////////////////
+    void        index()
+    {
+        const std::size_t chunk = 1 << 20;
+
+        Recorder::Stopwatch stopwatch(mRecorder.get(), Statistics::Timer::Index);
+
+        mOrdered = false;
+
+        mIndex.clear();
+        mLines = 0;
+
+        mBlocks.clear();
+        mCached = -1;
+
+        mStream.seekg(0, mStream.beg);
+
+        std::string buffer;
+        std::streamoff base = 0;
+        std::size_t position = 0;
+        bool end = false;
+
+        auto fill = [&]()
+        {
+            buffer.erase(0, position);
+            base += static_cast<std::streamoff>(position);
+            position = 0;
+
+            std::size_t size = buffer.size();
+            buffer.resize(size + chunk);
+
+            mStream.read(buffer.data() + size, static_cast<std::streamsize>(chunk));
+
+            buffer.resize(size + static_cast<std::size_t>(mStream.gcount()));
+            end = static_cast<std::size_t>(mStream.gcount()) < chunk;
+
+            count(Statistics::Counter::BytesRead, static_cast<std::uint64_t>(mStream.gcount()));
+        };
+
+        fill();
+
+        mEncoding = Codec::detect(buffer);
+
+        if(mEncoding == Encoding::Compressed)
+        {
+            footer();
+
+            mComplete = false;
+            mTerminated = true;
+
+            if(mFirsts.size() != mBlocks.size())
+            {
+                complete();
+            }
+        }
+        else
+        {
+            mComplete = true;
+
+            position = Codec::origin(mEncoding);
+
+            bool terminated = true;
+            bool done = false;
+
+            Codec::Record record;
+            while(!done)
+            {
+                bool found = Codec::next(buffer, position, mEncoding, record);
+
+                if(found && (end || mEncoding == Encoding::Binary || buffer[position + record.size - 1] == '\n'))
+                {
+                    if(record.removed)
+                    {
+                        mIndex.erase(std::string(record.name));
+                    }
+                    else
+                    {
+                        mIndex[std::string(record.name)] = {base + static_cast<std::streamoff>(position), record.size};
+                    }
+
+                    terminated = mEncoding == Encoding::Binary || buffer[position + record.size - 1] == '\n';
+
+                    position += record.size;
+
+                    ++mLines;
+                }
+                else if(!end)
+                {
+                    fill();
+                }
+                else
+                {
+                    done = true;
+                }
+            }
+
+            mTerminated = terminated && position == buffer.size();
+        }
+
+        mStream.clear();
+
+        count(Statistics::Counter::Indexings);
+        count(Statistics::Counter::Records, mLines);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Load the index persisted beside the file, if the
+    /// file didn't change since
+    ///
+    /// \return True if the index was loaded
+    ///
+    ////////////////////////////////////////////////////////////
+    bool        load()
+    {
+        bool loaded = false;
+
+        std::ifstream reader(mFile.parent_path() / ".cnroom" / (mFile.filename().string() + ".idx"), std::ios::binary);
+
+        if(reader)
+        {
+            try
+            {
+                std::string content((std::istreambuf_iterator<char>(reader)), std::istreambuf_iterator<char>());
+
+                std::string expected = stamp();
+
+                if(content.compare(0, expected.size(), expected) == 0)
+                {
+                    std::string_view cursor(content);
+                    cursor.remove_prefix(expected.size());
+
+                    std::uint8_t tag = Codec::get<std::uint8_t>(cursor);
+
+                    if(tag > static_cast<std::uint8_t>(Encoding::Compressed))
+                    {
+                        throw std::runtime_error("Corrupted index");
+                    }
+
+                    Encoding encoding = static_cast<Encoding>(tag);
+                    bool terminated = Codec::get<std::uint8_t>(cursor) != 0;
+                    std::size_t lines = Codec::get<std::uint64_t>(cursor);
+                    std::size_t count = Codec::get<std::uint64_t>(cursor);
+
+                    if(count > cursor.size())
+                    {
+                        throw std::runtime_error("Corrupted index");
+                    }
+
+                    Index index;
+                    index.reserve(count);
+
+                    Order order;
+                    order.reserve(count);
+
+                    for(std::size_t i = 0; i < count; ++i)
+                    {
+                        std::size_t length = Codec::get<std::uint32_t>(cursor);
+
+                        if(length > cursor.size())
+                        {
+                            throw std::runtime_error("Corrupted index");
+                        }
+
+                        std::string name(cursor.substr(0, length));
+                        cursor.remove_prefix(length);
+
+                        Location location;
+                        location.offset = static_cast<std::streamoff>(Codec::get<std::uint64_t>(cursor));
+                        location.length = Codec::get<std::uint64_t>(cursor);
+                        location.position = Codec::get<std::uint64_t>(cursor);
+
+                        order.push_back(&*index.emplace(std::move(name), location).first);
+                    }
+
+                    if(encoding == Encoding::Compressed)
+                    {
+                        footer();
+                    }
+
+                    mIndex = std::move(index);
+                    mOrder = std::move(order);
+                    mOrdered = true;
+                    mComplete = true;
+                    mLines = lines;
+                    mTerminated = terminated;
+                    mEncoding = encoding;
+
+                    loaded = true;
+                }
+            }
+            catch(const std::exception&)
+            {
+                loaded = false;
+            }
+        }
+
+        return loaded;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Persist the index beside the file, in the order of
+    /// the names
+    ///
+    /// The persisted index is only a cache of the file, failing
+    /// to write it isn't an error.
+    ///
+    ////////////////////////////////////////////////////////////
+    void        persist() const
+    {
+        try
+        {
+            std::string content = stamp();
+
+            content += static_cast<char>(mEncoding);
+            content += static_cast<char>(mTerminated);
+            Codec::put<std::uint64_t>(content, mLines);
+            Codec::put<std::uint64_t>(content, mOrder.size());
+
+            for(const auto& it: mOrder)
+            {
+                Codec::put<std::uint32_t>(content, static_cast<std::uint32_t>(it->first.size()));
+                content += it->first;
+                Codec::put<std::uint64_t>(content, static_cast<std::uint64_t>(it->second.offset));
+                Codec::put<std::uint64_t>(content, it->second.length);
+                Codec::put<std::uint64_t>(content, it->second.position);
+            }
+
+            std::filesystem::path temporary = sidecar(mFile, ".idx.tmp");
+
+            std::ofstream writer(temporary, std::ios::binary | std::ios::trunc);
+            writer.write(content.data(), static_cast<std::streamsize>(content.size()));
+            writer.close();
+
+            if(writer)
+            {
+                std::filesystem::rename(temporary, sidecar(mFile, ".idx"));
+            }
+        }
+        catch(const std::exception&)
+        {
+
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Identify the state of the file, a persisted index
+    /// is only valid for the state it was written for
+    ///
+    /// \return Magic number of the persisted index, size and
+    /// modification time of the file, and its inode where
+    /// available since rewriting the file replaces it
+    ///
+    ////////////////////////////////////////////////////////////
+    std::string stamp() const
+    {
+        std::string bytes("\x89" "CNI" "\x02" "\0\0\0", 8);
+
+        Codec::put<std::uint64_t>(bytes, std::filesystem::file_size(mFile));
+        Codec::put<std::uint64_t>(bytes, static_cast<std::uint64_t>(std::filesystem::last_write_time(mFile).time_since_epoch().count()));
+
+#if defined(__unix__) || defined(__APPLE__)
+        struct stat status;
+
+        if(::stat(mFile.c_str(), &status) != 0)
+        {
+            throw std::runtime_error("Could not stat \"" + mFile.string() + "\"");
+        }
+
+        Codec::put<std::uint64_t>(bytes, static_cast<std::uint64_t>(status.st_ino));
+#endif
+
+        return bytes;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Sort the keys by name if they aren't sorted since
+    /// the last modification, and persist the order
+    ///
+    /// \return Keys in the order of their names
+    ///
+    ////////////////////////////////////////////////////////////
+    const Order& ordered() const
+    {
+        complete();
+
+        std::lock_guard<std::mutex> lock(mOrdering);
+
+        if(!mOrdered)
+        {
+            mOrder.clear();
+            mOrder.reserve(mIndex.size());
+
+            for(const auto& it: mIndex)
+            {
+                mOrder.push_back(&it);
+            }
+
+            std::sort(mOrder.begin(), mOrder.end(), [](const Index::value_type* a, const Index::value_type* b)
+            {
+                return a->first < b->first;
+            });
+
+            mOrdered = true;
+
+            if(!mFile.empty())
+            {
+                persist();
+            }
+        }
+
+        return mOrder;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Find the first key whose name isn't less than a
+    /// name, the keys must be sorted
+    ///
+    /// \param name Name
+    ///
+    /// \return Position of the key in the order
+    ///
+    ////////////////////////////////////////////////////////////
+    std::size_t bound(const std::string& name) const
+    {
+        auto found = std::lower_bound(mOrder.begin(), mOrder.end(), name, [](const Index::value_type* it, const std::string& name)
+        {
+            return it->first < name;
+        });
+
+        return static_cast<std::size_t>(found - mOrder.begin());
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Check if a key exists, in the transaction or the
+    /// file
+    ///
+    /// \param name Name of the key
+    ///
+    /// \return True if the key exists
+    ///
+    ////////////////////////////////////////////////////////////
+    bool        contains(const std::string& name) const
+    {
+        const WriteBatch::Operation* pending = mTransaction ? mBatch.find(name) : nullptr;
+
+        Location location;
+
+        return pending ? pending->second.has_value() : locate(name, location);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Find the position of a key in the file
+    ///
+    /// Until complete() indexes the keys of a compressed file,
+    /// the block of the key is found by a binary search of the
+    /// first keys of the blocks, then decompressed and kept as
+    /// the last block read.
+    ///
+    /// \param name Name of the key
+    /// \param location Position to fill
+    ///
+    /// \return True if the key exists in the file
+    ///
+    ////////////////////////////////////////////////////////////
+    bool        locate(const std::string& name, Location& location) const
+    {
+        bool found = false;
+
+        if(mComplete)
+        {
+            auto it = mIndex.find(name);
+
+            if(it != mIndex.end())
+            {
+                location = it->second;
+                found = true;
+            }
+        }
+        else
+        {
+            std::lock_guard<std::mutex> lock(mReading);
+
+            auto block = mFirsts.upper_bound(name);
+
+            if(block != mFirsts.begin())
+            {
+                --block;
+
+                if(mCached != block->second)
+                {
+                    mCached = -1;
+
+                    unpack(mStream, block->second, mBlock);
+
+                    mCached = block->second;
+                }
+
+                std::size_t offset = 0;
+
+                Codec::Record record;
+                while(!found && Codec::next(mBlock, offset, mEncoding, record))
+                {
+                    if(record.name == name)
+                    {
+                        location = {block->second, record.size, offset};
+                        found = true;
+                    }
+
+                    offset += record.size;
+                }
+            }
+        }
+
+        return found;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Index every key of a compressed file found so far
+    /// block by block, each block is decompressed once
+    ///
+    /// Reading a single key doesn't need the whole index, the
+    /// operations going over every key build it the first time.
+    ///
+    ////////////////////////////////////////////////////////////
+    void        complete() const
+    {
+        if(!mComplete)
+        {
+            std::lock_guard<std::mutex> lock(mReading);
+
+            if(!mComplete)
+            {
+                Recorder::Stopwatch stopwatch(mRecorder.get(), Statistics::Timer::Index);
+
+                std::string raw;
+
+                Codec::Record record;
+                for(const auto& it: mBlocks)
+                {
+                    unpack(mStream, it.first, raw);
+
+                    std::size_t offset = 0;
+
+                    while(Codec::next(raw, offset, mEncoding, record))
+                    {
+                        mIndex[std::string(record.name)] = {it.first, record.size, offset};
+
+                        offset += record.size;
+
+                        ++mLines;
+                    }
+                }
+
+                count(Statistics::Counter::Records, mLines);
+
+                mComplete = true;
+            }
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Write a value of a key over the old one when both
+    /// have the same size in a binary file
+    ///
+    /// \param key Key with the new value
+    /// \param index Position of the value
+    ///
+    /// \return True if the value was written in place
+    ///
+    ////////////////////////////////////////////////////////////
+    bool        overwrite(const Key& key, std::size_t index)
+    {
+        bool written = false;
+
+        auto found = mIndex.find(key.name);
+
+        if(mStream && mEncoding == Encoding::Binary && !mTransaction && found != mIndex.end() && !std::holds_alternative<std::string>(key.values[index]) && !(mPinned && mPinned()))
+        {
+            std::string record;
+            fetch(found->second, record);
+
+            std::size_t offset = 0;
+
+            if(Codec::locate(record, index, offset) && static_cast<std::size_t>(record[offset]) == key.values[index].index())
+            {
+                std::string value = Codec::record(Key{"", {key.values[index]}}, Encoding::Binary).substr(13);
+
+                Journal::Entry entry(mJournal, mFile, key);
+
+                mStream.seekp(found->second.offset + static_cast<std::streamoff>(offset), mStream.beg);
+                mStream.write(value.data(), static_cast<std::streamsize>(value.size()));
+                mStream.flush();
+
+                if(!mStream)
+                {
+                    mStream.clear();
+
+                    throw std::runtime_error("Could not write, stream failed");
+                }
+
+                count(Statistics::Counter::Writes);
+                count(Statistics::Counter::BytesWritten, value.size());
+                track(key.name, &key);
+
+                written = true;
+            }
+        }
+
+        return written;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Store the large strings of a key as blobs
+    ///
+    /// \param key Key to write
+    /// \param outlined Copy of the key with references in place
+    /// of its large strings, if any
+    ///
+    /// \return True if a string was stored as a blob
+    ///
+    ////////////////////////////////////////////////////////////
+    bool        outline(const Key& key, Key& outlined)
+    {
+        bool found = false;
+
+        if(mOutline > 0)
+        {
+            for(std::size_t i = 0; i < key.values.size(); ++i)
+            {
+                const std::string* string = std::get_if<std::string>(&key.values[i]);
+
+                if(string && (string->size() > mOutline || Blobs::reserved(*string)))
+                {
+                    if(!found)
+                    {
+                        outlined = key;
+                        found = true;
+                    }
+
+                    if(!mBlobs)
+                    {
+                        mBlobs = std::make_shared<Blobs>(sidecar(mFile, ".blb"));
+                    }
+
+                    outlined.values[i] = mBlobs->store(*string);
+                }
+            }
+
+            if(found && mJournal)
+            {
+                Journal::persist(mBlobs->path());
+            }
+        }
+
+        return found;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Store the large strings of the keys of a batch as
+    /// blobs
+    ///
+    /// \param batch Operations to apply
+    /// \param outlined Copy of the batch with references in place
+    /// of its large strings, if any
+    ///
+    /// \return True if a string was stored as a blob
+    ///
+    ////////////////////////////////////////////////////////////
+    bool        outline(const WriteBatch& batch, WriteBatch& outlined)
+    {
+        bool found = false;
+
+        if(mOutline > 0)
+        {
+            Key key;
+
+            for(std::size_t i = 0; i < batch.mOperations.size(); ++i)
+            {
+                const std::optional<Key>& written = batch.mOperations[i].second;
+
+                if(written && outline(*written, key))
+                {
+                    if(!found)
+                    {
+                        outlined = batch;
+                        found = true;
+                    }
+
+                    outlined.mOperations[i].second = std::move(key);
+                }
+            }
+        }
+
+        return found;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Replace the references of a decoded key with the
+    /// content of their blobs
+    ///
+    /// \param key Key, pmr::Key or Record
+    ///
+    ////////////////////////////////////////////////////////////
+    template<typename Filled>
+    void        expand(Filled& key) const
+    {
+        if(mBlobs)
+        {
+            if constexpr(std::is_same_v<Filled, Key> || std::is_same_v<Filled, pmr::Key>)
+            {
+                using String = std::conditional_t<std::is_same_v<Filled, Key>, std::string, std::pmr::string>;
+
+                for(auto& it: key.values)
+                {
+                    if(String* string = std::get_if<String>(&it))
+                    {
+                        mBlobs->resolve(*string);
+                    }
+                }
+            }
+            else
+            {
+                auto resolve = [this](auto& typed)
+                {
+                    if constexpr(std::is_same_v<std::decay_t<decltype(typed)>, std::string>)
+                    {
+                        mBlobs->resolve(typed);
+                    }
+                };
+
+                std::apply([&resolve](auto&... typed){ (resolve(typed), ...); }, key.values);
+            }
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Fill a key with the values of the key of the same
+    /// name, from the transaction or the file
+    ///
+    /// \param name Name of the key
+    /// \param key Key or pmr::Key, without values
+    ///
+    ////////////////////////////////////////////////////////////
+    template<typename Filled>
+    void        fill(const std::string& name, Filled& key) const
+    {
+        Recorder::Stopwatch stopwatch(mRecorder.get(), Statistics::Timer::Read);
+
+        const WriteBatch::Operation* pending = mTransaction ? mBatch.find(name) : nullptr;
+
+        Location location;
+
+        if(pending)
+        {
+            if(pending->second)
+            {
+                if constexpr(std::is_same_v<Filled, Key>)
+                {
+                    key.values = pending->second->values;
+                }
+                else
+                {
+                    key.assign(pending->second->values);
+                }
+            }
+        }
+        else if(locate(name, location))
+        {
+            decode(location, key);
+        }
+
+        count(Statistics::Counter::Reads);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Read and decode the record of a key
+    ///
+    /// \param location Position of the record
+    /// \param key Key or pmr::Key to fill
+    ///
+    ////////////////////////////////////////////////////////////
+    template<typename Filled>
+    void        decode(const Location& location, Filled& key) const
+    {
+        thread_local std::string buffer;
+
+        fetch(location, buffer);
+
+        Codec::Record record;
+
+        if(Codec::next(buffer, 0, mEncoding, record))
+        {
+            Codec::parse(record.values, mEncoding, key);
+
+            expand(key);
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Visit every key of the stream in one pass over the
+    /// file, followed by the writes of the transaction
+    ///
+    /// \param visitor Function called with each key, returns
+    /// false to stop
+    ///
+    /// \return True if every key was visited
+    ///
+    ////////////////////////////////////////////////////////////
+    template<typename Filled>
+    bool        visit(const std::function<bool(const Filled&)>& visitor) const
+    {
+        const std::size_t chunk = 1 << 20;
+
+        Recorder::Stopwatch stopwatch(mRecorder.get(), Statistics::Timer::Scan);
+
+        complete();
+
+        std::vector<const Index::value_type*> live;
+        live.reserve(mIndex.size());
+
+        for(const auto& it: mIndex)
+        {
+            if(!mTransaction || !mBatch.find(it.first))
+            {
+                live.push_back(&it);
+            }
+        }
+
+        std::sort(live.begin(), live.end(), [](const Index::value_type* a, const Index::value_type* b)
+        {
+            return a->second.offset < b->second.offset || (a->second.offset == b->second.offset && a->second.position < b->second.position);
+        });
+
+        std::ifstream file(mFile, std::ios::binary);
+
+        if(!file)
+        {
+            throw std::runtime_error("Could not read, stream failed");
+        }
+
+        std::string buffer;
+        std::streamoff base = 0;
+        std::streamoff block = -1;
+        std::uint64_t bytes = 0;
+        std::size_t i = 0;
+        bool end = false;
+        bool done = false;
+
+        Filled key;
+        Codec::Record record;
+        for(; i < live.size() && !done; ++i)
+        {
+            const Location& location = live[i]->second;
+
+            std::size_t position = location.position;
+
+            if(mEncoding == Encoding::Compressed)
+            {
+                if(block != location.offset)
+                {
+                    unpack(file, location.offset, buffer);
+
+                    block = location.offset;
+                }
+
+                if(position + location.length > buffer.size())
+                {
+                    throw std::runtime_error("Could not read, stream failed");
+                }
+            }
+            else
+            {
+                position = static_cast<std::size_t>(location.offset - base);
+
+                while(position + location.length > buffer.size() && !end)
+                {
+                    std::size_t start = std::min(position, buffer.size());
+
+                    buffer.erase(0, start);
+                    base += static_cast<std::streamoff>(start);
+                    position -= start;
+
+                    std::size_t size = buffer.size();
+                    buffer.resize(size + std::max(chunk, location.length));
+
+                    file.read(buffer.data() + size, static_cast<std::streamsize>(buffer.size() - size));
+
+                    buffer.resize(size + static_cast<std::size_t>(file.gcount()));
+                    bytes += static_cast<std::uint64_t>(file.gcount());
+                    end = !file;
+                }
+
+                if(position + location.length > buffer.size())
+                {
+                    throw std::runtime_error("Could not read, stream failed");
+                }
+            }
+
+            key.name = live[i]->first;
+
+            if constexpr(std::is_same_v<Filled, Key>)
+            {
+                key.values.clear();
+            }
+
+            if(Codec::next(std::string_view(buffer.data() + position, location.length), 0, mEncoding, record))
+            {
+                Codec::parse(record.values, mEncoding, key);
+
+                expand(key);
+            }
+
+            done = !visitor(key);
+        }
+
+        count(Statistics::Counter::Records, i);
+        count(Statistics::Counter::BytesRead, bytes);
+
+        if(mTransaction)
+        {
+            for(auto it = mBatch.mOperations.begin(); it != mBatch.mOperations.end() && !done; ++it)
+            {
+                if(it->second)
+                {
+                    if constexpr(std::is_same_v<Filled, Key>)
+                    {
+                        done = !visitor(*it->second);
+                    }
+                    else
+                    {
+                        key.name = it->first;
+                        key.assign(it->second->values);
+
+                        done = !visitor(key);
+                    }
+                }
+            }
+        }
+
+        return !done;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Read the record at a position, one thread at a time
+    ///
+    /// The last block read from a compressed file is kept, so
+    /// that reading its neighbours doesn't decompress it again.
+    ///
+    /// \param location Position of the record
+    /// \param buffer Buffer to fill with the record
+    ///
+    ////////////////////////////////////////////////////////////
+    void        fetch(const Location& location, std::string& buffer) const
+    {
+        std::lock_guard<std::mutex> lock(mReading);
+
+        if(!mStream)
+        {
+            throw std::runtime_error("Could not read, stream failed");
+        }
+
+        if(mEncoding == Encoding::Compressed)
+        {
+            if(mCached != location.offset)
+            {
+                mCached = -1;
+
+                unpack(mStream, location.offset, mBlock);
+
+                mCached = location.offset;
+            }
+
+            if(location.position + location.length > mBlock.size())
+            {
+                throw std::runtime_error("Could not read, stream failed");
+            }
+
+            buffer.assign(mBlock, location.position, location.length);
+        }
+        else
+        {
+            buffer.resize(location.length);
+
+            mStream.seekg(location.offset, mStream.beg);
+            mStream.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+
+            mStream.clear();
+
+            count(Statistics::Counter::BytesRead, location.length);
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Append records at the end of the file
+    ///
+    /// \param records Records to append
+    /// \param count Number of records
+    ///
+    /// \return Offset of the first record in the file
+    ///
+    ////////////////////////////////////////////////////////////
+    std::streamoff append(const std::string& records, std::size_t count)
+    {
+        mOrdered = false;
+
+        if(!mTerminated && mEncoding == Encoding::Binary)
+        {
+            compact();
+        }
+
+        mStream.seekp(0, mStream.end);
+
+        std::streamoff offset = mStream.tellp();
+
+        if(!mTerminated)
+        {
+            mStream.put('\n');
+            ++offset;
+        }
+
+        mStream.write(records.data(), static_cast<std::streamsize>(records.size()));
+        mStream.flush();
+
+        mStream.clear();
+
+        mTerminated = true;
+
+        mLines += count;
+
+        this->count(Statistics::Counter::Appends);
+        this->count(Statistics::Counter::BytesWritten, records.size());
+
+        return offset;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Compact the file if the ratio of dead records is
+    /// above the threshold
+    ///
+    ////////////////////////////////////////////////////////////
+    void        collect()
+    {
+        complete();
+
+        if(mLines > 0 && static_cast<double>(mLines - mIndex.size()) / static_cast<double>(mLines) > mThreshold)
+        {
+            compact();
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Read the whole file at once
+    ///
+    /// \return Content of the file
+    ///
+    ////////////////////////////////////////////////////////////
+    std::string contents()
+    {
+        mStream.seekg(0, mStream.end);
+
+        std::string content(static_cast<std::size_t>(mStream.tellg()), '\0');
+
+        mStream.seekg(0, mStream.beg);
+        mStream.read(content.data(), static_cast<std::streamsize>(content.size()));
+
+        mStream.clear();
+
+        count(Statistics::Counter::BytesRead, content.size());
+
+        return content;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Rewrite the file in one pass with the live records
+    /// that the batch doesn't touch, followed by its writes
+    ///
+    /// \param batch Operations to apply
+    /// \param encoding Encoding of the rewritten file
+    ///
+    ////////////////////////////////////////////////////////////
+    void        rewrite(const WriteBatch& batch, Encoding encoding)
+    {
+        Recorder::Stopwatch stopwatch(mRecorder.get(), Statistics::Timer::Rewrite);
+
+        complete();
+
+        mOrdered = false;
+
+        std::vector<const Index::value_type*> kept;
+        kept.reserve(mIndex.size());
+
+        for(const auto& it: mIndex)
+        {
+            if(!batch.find(it.first))
+            {
+                kept.push_back(&it);
+            }
+        }
+
+        std::sort(kept.begin(), kept.end(), [](const Index::value_type* a, const Index::value_type* b){ return a->second.offset < b->second.offset || (a->second.offset == b->second.offset && a->second.position < b->second.position); });
+
+        Index index;
+        index.reserve(kept.size() + batch.mOperations.size());
+
+        std::map<std::streamoff, Codec::Block> blocks;
+
+        std::string rewritten;
+
+        if(encoding == Encoding::Compressed || mEncoding == Encoding::Compressed)
+        {
+            rewritten = pack(kept, batch, encoding, index, blocks);
+        }
+        else
+        {
+            std::string content = contents();
+
+            rewritten = encoding == Encoding::Binary ? Codec::header() : std::string();
+            rewritten.reserve(content.size());
+
+            for(const auto& it: kept)
+            {
+                std::size_t offset = rewritten.size();
+
+                if(encoding == mEncoding)
+                {
+                    rewritten.append(content, static_cast<std::size_t>(it->second.offset), it->second.length);
+
+                    if(encoding == Encoding::Text && rewritten.back() != '\n')
+                    {
+                        rewritten += '\n';
+                    }
+                }
+                else
+                {
+                    Codec::Record record;
+                    Codec::next(content, static_cast<std::size_t>(it->second.offset), mEncoding, record);
+
+                    Key key{it->first, {}};
+                    Codec::parse(record.values, mEncoding, key);
+
+                    rewritten += Codec::record(key, encoding);
+                }
+
+                index.emplace(it->first, Location{static_cast<std::streamoff>(offset), rewritten.size() - offset});
+            }
+
+            for(const auto& it: batch.mOperations)
+            {
+                if(it.second)
+                {
+                    std::string record = Codec::record(*it.second, encoding);
+
+                    index[it.first] = {static_cast<std::streamoff>(rewritten.size()), record.size()};
+
+                    rewritten += record;
+                }
+            }
+        }
+
+        replace(rewritten);
+
+        mIndex = std::move(index);
+        mBlocks = std::move(blocks);
+        mComplete = true;
+        mLines = mIndex.size();
+        mEncoding = encoding;
+
+        count(Statistics::Counter::Rewrites);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Build the content of a rewritten file when it is or
+    /// was compressed, the records of a compressed file sorted by
+    /// name and gathered in blocks
+    ///
+    /// \param kept Live records that the batch doesn't touch, in
+    /// the order of the file
+    /// \param batch Operations to apply
+    /// \param encoding Encoding of the rewritten file
+    /// \param index Index to fill with the position of each key
+    /// \param blocks Blocks to fill, if the rewritten file is
+    /// compressed
+    ///
+    /// \return Content of the rewritten file
+    ///
+    ////////////////////////////////////////////////////////////
+    std::string pack(const std::vector<const Index::value_type*>& kept, const WriteBatch& batch, Encoding encoding, Index& index, std::map<std::streamoff, Codec::Block>& blocks)
+    {
+        std::string content = mEncoding != Encoding::Compressed ? contents() : std::string();
+
+        std::vector<std::pair<std::string_view, std::string>> records;
+        records.reserve(kept.size() + batch.mOperations.size());
+
+        std::string raw;
+        std::streamoff block = -1;
+
+        for(const auto& it: kept)
+        {
+            std::string_view bytes;
+
+            if(mEncoding == Encoding::Compressed)
+            {
+                if(block != it->second.offset)
+                {
+                    unpack(mStream, it->second.offset, raw);
+
+                    block = it->second.offset;
+                }
+
+                bytes = std::string_view(raw).substr(it->second.position, it->second.length);
+            }
+            else
+            {
+                bytes = std::string_view(content).substr(static_cast<std::size_t>(it->second.offset), it->second.length);
+            }
+
+            if((encoding == Encoding::Text) == (mEncoding == Encoding::Text))
+            {
+                records.emplace_back(it->first, std::string(bytes));
+            }
+            else
+            {
+                Codec::Record record;
+                Codec::next(bytes, 0, mEncoding, record);
+
+                Key key{it->first, {}};
+                Codec::parse(record.values, mEncoding, key);
+
+                records.emplace_back(it->first, Codec::record(key, encoding));
+            }
+        }
+
+        for(const auto& it: batch.mOperations)
+        {
+            if(it.second)
+            {
+                records.emplace_back(it.first, Codec::record(*it.second, encoding));
+            }
+        }
+
+        std::string rewritten = encoding != Encoding::Text ? Codec::header(encoding) : std::string();
+
+        if(encoding == Encoding::Compressed)
+        {
+            std::sort(records.begin(), records.end(), [](const auto& a, const auto& b){ return a.first < b.first; });
+
+            std::vector<Codec::Block> table;
+
+            std::string gathered;
+            std::size_t first = 0;
+
+            auto close = [&](std::size_t last)
+            {
+                Codec::Block entry{rewritten.size(), 0, static_cast<std::uint32_t>(gathered.size()), std::string(records[first].first)};
+
+                std::string packed = Codec::compress(gathered);
+
+                entry.packed = static_cast<std::uint32_t>(packed.size());
+
+                rewritten += packed;
+
+                std::size_t position = 0;
+
+                for(std::size_t i = first; i < last; ++i)
+                {
+                    index.emplace(records[i].first, Location{static_cast<std::streamoff>(entry.offset), records[i].second.size(), position});
+
+                    position += records[i].second.size();
+                }
+
+                blocks.emplace(static_cast<std::streamoff>(entry.offset), entry);
+                table.push_back(std::move(entry));
+
+                gathered.clear();
+                first = last;
+            };
+
+            for(std::size_t i = 0; i < records.size(); ++i)
+            {
+                gathered += records[i].second;
+
+                if(gathered.size() >= Codec::block)
+                {
+                    close(i + 1);
+                }
+            }
+
+            if(!gathered.empty())
+            {
+                close(records.size());
+            }
+
+            rewritten += Codec::footer(table, rewritten.size());
+        }
+        else
+        {
+            for(const auto& it: records)
+            {
+                index.emplace(it.first, Location{static_cast<std::streamoff>(rewritten.size()), it.second.size()});
+
+                rewritten += it.second;
+            }
+        }
+
+        return rewritten;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Rewrite the file with its keys merged with sorted
+    /// records, written to the temporary file as they come so the
+    /// file is never held in memory
+    ///
+    /// A record replaces the key of the same name in the file.
+    /// Keys are written in the order of their names, in the
+    /// encoding of the file.
+    ///
+    /// \param source Function filling the next binary record,
+    /// records sorted by name without duplicates, returns false
+    /// once there are none left
+    ///
+    ////////////////////////////////////////////////////////////
+    void        pour(const std::function<bool(std::string&)>& source)
+    {
+        const std::size_t chunk = 1 << 20;
+
+        Recorder::Stopwatch stopwatch(mRecorder.get(), Statistics::Timer::Rewrite);
+
+        if(!mStream)
+        {
+            throw std::runtime_error("Could not load, stream failed");
+        }
+
+        if(mTransaction)
+        {
+            throw std::runtime_error("Could not load, a transaction is in progress");
+        }
+
+        const Order& order = ordered();
+
+        std::filesystem::path temporary = sidecar(mFile, ".tmp");
+
+        std::ofstream writer(temporary, std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+
+        Index index;
+        index.reserve(order.size());
+
+        std::map<std::streamoff, Codec::Block> blocks;
+        std::vector<Codec::Block> table;
+
+        std::string pending = mEncoding != Encoding::Text ? Codec::header(mEncoding) : std::string();
+        std::uint64_t written = 0;
+
+        std::string raw;
+        std::string first;
+        std::vector<std::pair<std::string, Location>> gathered;
+
+        auto flush = [&]()
+        {
+            writer.write(pending.data(), static_cast<std::streamsize>(pending.size()));
+
+            written += pending.size();
+            pending.clear();
+        };
+
+        auto seal = [&]()
+        {
+            Codec::Block entry{written + pending.size(), 0, static_cast<std::uint32_t>(raw.size()), std::move(first)};
+
+            std::string packed = Codec::compress(raw);
+
+            entry.packed = static_cast<std::uint32_t>(packed.size());
+
+            pending += packed;
+
+            for(auto& it: gathered)
+            {
+                it.second.offset = static_cast<std::streamoff>(entry.offset);
+
+                index.emplace(std::move(it.first), it.second);
+            }
+
+            blocks.emplace(static_cast<std::streamoff>(entry.offset), entry);
+            table.push_back(std::move(entry));
+
+            raw.clear();
+            first.clear();
+            gathered.clear();
+        };
+
+        auto emit = [&](const std::string& name, const std::string& bytes)
+        {
+            if(mEncoding == Encoding::Compressed)
+            {
+                if(raw.empty())
+                {
+                    first = name;
+                }
+
+                gathered.emplace_back(name, Location{0, bytes.size(), raw.size()});
+
+                raw += bytes;
+
+                if(raw.size() >= Codec::block)
+                {
+                    seal();
+                }
+            }
+            else
+            {
+                index.emplace(name, Location{static_cast<std::streamoff>(written + pending.size()), bytes.size()});
+
+                pending += bytes;
+            }
+
+            if(pending.size() >= chunk)
+            {
+                flush();
+            }
+        };
+
+        std::string record;
+        Codec::Record loaded;
+
+        auto next = [&]()
+        {
+            bool found = source(record);
+
+            if(found && (!Codec::next(record, 0, Encoding::Binary, loaded) || loaded.removed))
+            {
+                throw std::runtime_error("Could not load, corrupted record");
+            }
+
+            return found;
+        };
+
+        std::string bytes;
+        std::size_t i = 0;
+        bool more = next();
+
+        while(more || i < order.size())
+        {
+            if(more && (i == order.size() || loaded.name <= order[i]->first))
+            {
+                if(i < order.size() && loaded.name == order[i]->first)
+                {
+                    ++i;
+                }
+
+                if(mEncoding == Encoding::Text)
+                {
+                    Key key{std::string(loaded.name), {}};
+                    Codec::parse(loaded.values, Encoding::Binary, key);
+
+                    emit(key.name, Codec::record(key, Encoding::Text));
+                }
+                else
+                {
+                    emit(std::string(loaded.name), record);
+                }
+
+                more = next();
+            }
+            else
+            {
+                fetch(order[i]->second, bytes);
+
+                if(mEncoding == Encoding::Text && (bytes.empty() || bytes.back() != '\n'))
+                {
+                    bytes += '\n';
+                }
+
+                emit(order[i]->first, bytes);
+
+                ++i;
+            }
+        }
+
+        if(mEncoding == Encoding::Compressed)
+        {
+            if(!raw.empty())
+            {
+                seal();
+            }
+
+            pending += Codec::footer(table, written + pending.size());
+        }
+
+        flush();
+
+        writer.close();
+
+        if(!writer)
+        {
+            throw std::runtime_error("Stream failed to write file on \"" + temporary.string() + "\"");
+        }
+
+        count(Statistics::Counter::BytesWritten, written);
+
+        install(temporary);
+
+        mOrdered = false;
+
+        mIndex = std::move(index);
+        mBlocks = std::move(blocks);
+        mComplete = true;
+        mLines = mIndex.size();
+
+        count(Statistics::Counter::Rewrites);
+
+        if(!mSecondary.empty())
+        {
+            build();
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Read the index of the blocks of a compressed file,
+    /// the first keys of the blocks are kept if they are sorted
+    ///
+    ////////////////////////////////////////////////////////////
+    void        footer()
+    {
+        mStream.clear();
+        mStream.seekg(0, mStream.end);
+
+        std::uint64_t size = static_cast<std::uint64_t>(mStream.tellg());
+
+        std::string end(16, '\0');
+
+        if(size >= end.size())
+        {
+            mStream.seekg(static_cast<std::streamoff>(size - end.size()), mStream.beg);
+            mStream.read(end.data(), static_cast<std::streamsize>(end.size()));
+        }
+
+        std::uint64_t offset = Codec::trailer(end, size);
+
+        std::string bytes(static_cast<std::size_t>(size - end.size() - offset), '\0');
+
+        mStream.seekg(static_cast<std::streamoff>(offset), mStream.beg);
+        mStream.read(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+
+        bool read = static_cast<bool>(mStream);
+
+        mStream.clear();
+
+        if(!read)
+        {
+            throw std::runtime_error("Could not read, stream failed");
+        }
+
+        count(Statistics::Counter::BytesRead, end.size() + bytes.size());
+
+        mBlocks.clear();
+        mFirsts.clear();
+        mCached = -1;
+
+        bool sorted = true;
+
+        for(auto& it: Codec::blocks(bytes))
+        {
+            if(it.offset < Codec::header().size() || it.offset + it.packed > offset)
+            {
+                throw std::runtime_error("Corrupted compressed drawer");
+            }
+
+            sorted = sorted && (mFirsts.empty() || mFirsts.rbegin()->first < it.first);
+
+            mFirsts.emplace(it.first, static_cast<std::streamoff>(it.offset));
+            mBlocks.emplace(static_cast<std::streamoff>(it.offset), std::move(it));
+        }
+
+        if(!sorted)
+        {
+            mFirsts.clear();
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Read and decompress a block of a compressed file
+    ///
+    /// \param stream Stream on the file
+    /// \param offset Offset of the block
+    /// \param raw String to fill with the block
+    ///
+    ////////////////////////////////////////////////////////////
+    void        unpack(std::istream& stream, std::streamoff offset, std::string& raw) const
+    {
+        auto found = mBlocks.find(offset);
+
+        if(found == mBlocks.end())
+        {
+            throw std::runtime_error("Could not read, stream failed");
+        }
+
+        std::string packed(found->second.packed, '\0');
+
+        stream.seekg(offset, stream.beg);
+        stream.read(packed.data(), static_cast<std::streamsize>(packed.size()));
+
+        bool read = static_cast<bool>(stream);
+
+        stream.clear();
+
+        if(!read)
+        {
+            throw std::runtime_error("Could not read, stream failed");
+        }
+
+        count(Statistics::Counter::BytesRead, packed.size());
+
+        Codec::decompress(packed, found->second.size, raw);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Write the new content to a temporary file and
+    /// rename it over the file, so the file is never half written
+    ///
+    /// \param content Content of the file
+    ///
+    ////////////////////////////////////////////////////////////
+    void        replace(const std::string& content)
+    {
+        std::filesystem::path temporary = sidecar(mFile, ".tmp");
+
+        std::ofstream writer(temporary, std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+
+        writer.write(content.data(), static_cast<std::streamsize>(content.size()));
+        writer.close();
+
+        if(!writer)
+        {
+            throw std::runtime_error("Stream failed to write file on \"" + temporary.string() + "\"");
+        }
+
+        count(Statistics::Counter::BytesWritten, content.size());
+
+        install(temporary);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Rename a temporary file written in full over the
+    /// file and open it again
+    ///
+    /// \param temporary Path to the temporary file
+    ///
+    ////////////////////////////////////////////////////////////
+    void        install(const std::filesystem::path& temporary)
+    {
+        if(mJournal)
+        {
+            Journal::persist(temporary);
+        }
+
+        mStream.close();
+
+        std::filesystem::rename(temporary, mFile);
+
+        mStream.open(mFile, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+
+        if(!mStream)
+        {
+            throw std::runtime_error("Stream failed to open file on \"" + mFile.string() + "\"");
+        }
+
+        mTerminated = true;
+        mCached = -1;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Count events in the statistics of the stream
+    ///
+    /// \param counter Counter
+    /// \param value Number of events, 1 by default
+    ///
+    ////////////////////////////////////////////////////////////
+    void        count(Statistics::Counter counter, std::uint64_t value = 1) const
+    {
+        if constexpr(statistics_enabled)
+        {
+            mRecorder->count(counter, value);
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Count the writes and removals of a batch applied
+    /// to the file
+    ///
+    /// \param batch Batch applied
+    ///
+    ////////////////////////////////////////////////////////////
+    void        tally(const WriteBatch& batch) const
+    {
+        if constexpr(statistics_enabled)
+        {
+            std::uint64_t writes = 0;
+
+            for(const auto& it: batch.mOperations)
+            {
+                if(it.second)
+                {
+                    ++writes;
+                }
+            }
+
+            count(Statistics::Counter::Writes, writes);
+            count(Statistics::Counter::Removals, batch.mOperations.size() - writes);
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Encode a value for hash lookups, its type included
+    ///
+    /// \param value Value
+    ///
+    /// \return Encoded value
+    ///
+    ////////////////////////////////////////////////////////////
+    static std::string token(const Types& value)
+    {
+        std::string encoded = Codec::record(Key{"", {value}}, Encoding::Binary);
+
+        return encoded.substr(13);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the number of a value for ordered lookups
+    ///
+    /// \param value Value
+    ///
+    /// \return Number, empty if the value isn't an int or a
+    /// double, or is NaN
+    ///
+    ////////////////////////////////////////////////////////////
+    static std::optional<double> numeric(const Types& value)
+    {
+        std::optional<double> number;
+
+        if(std::holds_alternative<int>(value))
+        {
+            number = std::get<int>(value);
+        }
+        else if(std::holds_alternative<double>(value) && std::get<double>(value) == std::get<double>(value))
+        {
+            number = std::get<double>(value);
+        }
+
+        return number;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the index of a value
+    ///
+    /// \param value Position of the value in the keys
+    ///
+    /// \return Index
+    ///
+    ////////////////////////////////////////////////////////////
+    const Secondary& indexed(std::size_t value) const
+    {
+        auto found = mSecondary.find(value);
+
+        if(found == mSecondary.end())
+        {
+            throw std::runtime_error("Could not find, value " + std::to_string(value) + " isn't indexed");
+        }
+
+        return found->second;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Read the keys found by an index, without the keys
+    /// removed by a transaction in progress
+    ///
+    /// \param names Names of the keys
+    ///
+    /// \return Keys in the order of the names
+    ///
+    ////////////////////////////////////////////////////////////
+    std::vector<Key> matching(const std::vector<std::string>& names) const
+    {
+        std::vector<Key> keys = read_many(names);
+
+        keys.erase(std::remove_if(keys.begin(), keys.end(), [](const Key& key){ return key.values.empty(); }), keys.end());
+
+        return keys;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Add a key to an index or remove it
+    ///
+    /// \param secondary Index
+    /// \param name Name of the key
+    /// \param value Value of the key, nullptr to remove the key
+    ///
+    ////////////////////////////////////////////////////////////
+    static void entry(Secondary& secondary, const std::string& name, const Types* value)
+    {
+        auto found = secondary.values.find(name);
+
+        if(found != secondary.values.end())
+        {
+            if(secondary.lookup == Lookup::Hash)
+            {
+                auto keys = secondary.hashed.find(token(found->second));
+
+                keys->second.erase(name);
+
+                if(keys->second.empty())
+                {
+                    secondary.hashed.erase(keys);
+                }
+            }
+            else
+            {
+                auto range = secondary.ordered.equal_range(*numeric(found->second));
+
+                bool erased = false;
+
+                for(auto it = range.first; it != range.second && !erased; ++it)
+                {
+                    if(it->second == name)
+                    {
+                        secondary.ordered.erase(it);
+
+                        erased = true;
+                    }
+                }
+            }
+
+            secondary.values.erase(found);
+        }
+
+        if(value)
+        {
+            if(secondary.lookup == Lookup::Hash)
+            {
+                secondary.hashed[token(*value)].insert(name);
+
+                secondary.values.emplace(name, *value);
+            }
+            else if(std::optional<double> number = numeric(*value))
+            {
+                secondary.ordered.emplace(*number, name);
+
+                secondary.values.emplace(name, *value);
+            }
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Update the indexes after a key was written or
+    /// removed
+    ///
+    /// \param name Name of the key
+    /// \param key Key written, nullptr if removed
+    ///
+    ////////////////////////////////////////////////////////////
+    void        track(const std::string& name, const Key* key)
+    {
+        for(auto& it: mSecondary)
+        {
+            entry(it.second, name, key && it.first < key->values.size() ? &key->values[it.first] : nullptr);
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Update the indexes after a batch was applied
+    ///
+    /// \param batch Batch applied
+    ///
+    ////////////////////////////////////////////////////////////
+    void        track(const WriteBatch& batch)
+    {
+        if(!mSecondary.empty())
+        {
+            for(const auto& it: batch.mOperations)
+            {
+                track(it.first, it.second ? &*it.second : nullptr);
+            }
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Fill an index with the keys of the file, in one
+    /// pass
+    ///
+    /// \param value Position of the value in the keys
+    /// \param secondary Index, empty
+    ///
+    ////////////////////////////////////////////////////////////
+    void        populate(std::size_t value, Secondary& secondary) const
+    {
+        visit<Key>([&](const Key& key)
+        {
+            if(value < key.values.size())
+            {
+                entry(secondary, key.name, &key.values[value]);
+            }
+
+            return true;
+        });
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Rebuild every index from the keys of the file, in
+    /// one pass
+    ///
+    ////////////////////////////////////////////////////////////
+    void        build()
+    {
+        for(auto& it: mSecondary)
+        {
+            it.second = Secondary{it.second.lookup, {}, {}, {}};
+        }
+
+        visit<Key>([&](const Key& key)
+        {
+            track(key.name, &key);
+
+            return true;
+        });
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Load the indexes persisted beside the file, and
+    /// rebuild them if the file changed since
+    ///
+    ////////////////////////////////////////////////////////////
+    void        load_indexes()
+    {
+        mSecondary.clear();
+
+        std::filesystem::path path = mFile.parent_path() / ".cnroom" / (mFile.filename().string() + ".sdx");
+
+        std::ifstream reader(path, std::ios::binary);
+
+        if(reader)
+        {
+            std::string content((std::istreambuf_iterator<char>(reader)), std::istreambuf_iterator<char>());
+
+            std::string_view cursor(content);
+
+            if(cursor.substr(0, 8) != std::string_view("\x89" "CNS" "\x01" "\0\0\0", 8))
+            {
+                throw std::runtime_error("Corrupted indexes \"" + path.string() + "\"");
+            }
+
+            cursor.remove_prefix(8);
+
+            std::size_t count = Codec::get<std::uint32_t>(cursor);
+
+            for(std::size_t i = 0; i < count; ++i)
+            {
+                std::size_t value = Codec::get<std::uint32_t>(cursor);
+                std::uint8_t lookup = Codec::get<std::uint8_t>(cursor);
+
+                if(lookup > static_cast<std::uint8_t>(Lookup::Ordered))
+                {
+                    throw std::runtime_error("Corrupted indexes \"" + path.string() + "\"");
+                }
+
+                mSecondary[value].lookup = static_cast<Lookup>(lookup);
+            }
+
+            bool loaded = false;
+
+            try
+            {
+                std::size_t length = Codec::get<std::uint32_t>(cursor);
+
+                if(cursor.substr(0, length) == stamp())
+                {
+                    cursor.remove_prefix(length);
+
+                    Codec::Record record;
+
+                    for(auto& it: mSecondary)
+                    {
+                        std::size_t entries = Codec::get<std::uint64_t>(cursor);
+
+                        for(std::size_t i = 0; i < entries; ++i)
+                        {
+                            if(!Codec::next(cursor, 0, Encoding::Binary, record))
+                            {
+                                throw std::runtime_error("Corrupted indexes");
+                            }
+
+                            Key key{std::string(record.name), {}};
+                            Codec::parse(record.values, Encoding::Binary, key);
+
+                            if(key.values.size() != 1)
+                            {
+                                throw std::runtime_error("Corrupted indexes");
+                            }
+
+                            entry(it.second, key.name, &key.values[0]);
+
+                            cursor.remove_prefix(record.size);
+                        }
+                    }
+
+                    loaded = true;
+                }
+            }
+            catch(const std::exception&)
+            {
+                loaded = false;
+            }
+
+            if(!loaded)
+            {
+                build();
+            }
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Persist the definitions and entries of the indexes
+    /// beside the file
+    ///
+    ////////////////////////////////////////////////////////////
+    void        persist_indexes() const
+    {
+        std::string content("\x89" "CNS" "\x01" "\0\0\0", 8);
+
+        Codec::put<std::uint32_t>(content, static_cast<std::uint32_t>(mSecondary.size()));
+
+        for(const auto& it: mSecondary)
+        {
+            Codec::put<std::uint32_t>(content, static_cast<std::uint32_t>(it.first));
+            content += static_cast<char>(it.second.lookup);
+        }
+
+        std::string stamped = stamp();
+
+        Codec::put<std::uint32_t>(content, static_cast<std::uint32_t>(stamped.size()));
+        content += stamped;
+
+        for(const auto& it: mSecondary)
+        {
+            Codec::put<std::uint64_t>(content, it.second.values.size());
+
+            for(const auto& entry: it.second.values)
+            {
+                content += Codec::record(Key{entry.first, {entry.second}}, Encoding::Binary);
+            }
+        }
+
+        std::filesystem::path temporary = sidecar(mFile, ".sdx.tmp");
+
+        std::ofstream writer(temporary, std::ios::binary | std::ios::trunc);
+        writer.write(content.data(), static_cast<std::streamsize>(content.size()));
+        writer.close();
+
+        if(!writer)
+        {
+            throw std::runtime_error("Stream failed to write indexes on \"" + temporary.string() + "\"");
+        }
+
+        std::filesystem::rename(temporary, sidecar(mFile, ".sdx"));
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the name of a drawer, as the room and its
+    /// snapshots know it
+    ///
+    /// \param file Path to the file
+    ///
+    /// \return Normalized path
+    ///
+    ////////////////////////////////////////////////////////////
+    static std::string normalize(const std::filesystem::path& file)
+    {
+        std::string name = file.lexically_normal().generic_string();
+
+        if(name.size() > 1 && name.back() == '/')
+        {
+            name.pop_back();
+        }
+
+        return name;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the path of a file kept beside a drawer, in
+    /// the hidden .cnroom directory of its parent
+    ///
+    /// \param file Path to the drawer
+    /// \param extension Extension of the file
+    ///
+    /// \return Path to the file, its directory is created
+    ///
+    ////////////////////////////////////////////////////////////
+    static std::filesystem::path sidecar(const std::filesystem::path& file, const std::string& extension)
+    {
+        std::filesystem::path directory = file.parent_path() / ".cnroom";
+
+        std::filesystem::create_directories(directory);
+
+        return directory / (file.filename().string() + extension);
+    }
+
+    ////////////////////////////////////////////////////////////
+    // Member data
+    ////////////////////////////////////////////////////////////
+    mutable std::fstream    mStream;        ///< Stream
+    mutable std::mutex      mReading;       ///< Lock of the stream between reading threads
+    std::filesystem::path   mFile;          ///< Path to the file to operate
+    Key                     mKey;           ///< Key
+    mutable Index           mIndex;         ///< Position of each key in the file
+    mutable std::size_t     mLines;         ///< Number of records in the file, dead ones included
+    bool                    mTerminated;    ///< True if the file ends with a line break
+    Mode                    mMode;          ///< Way to store modifications
+    double                  mThreshold;     ///< Ratio of dead records that triggers a compaction
+    std::size_t             mOutline;       ///< Size above which strings are stored as blobs, 0 to keep them in the file
+    bool                    mTransaction;   ///< True if a transaction is in progress
+    WriteBatch              mBatch;         ///< Operations of the transaction
+    Encoding                mEncoding;      ///< Encoding of the file
+    mutable std::mutex      mOrdering;      ///< Lock of the order between reading threads
+    mutable Order           mOrder;         ///< Keys in the order of their names
+    mutable bool            mOrdered;       ///< True if the order is up to date
+    std::shared_ptr<Journal> mJournal;      ///< Journal logging the modifications, if any
+    std::shared_ptr<Recorder> mRecorder;    ///< Statistics of the stream, shared with its room
+    std::map<std::streamoff, Codec::Block> mBlocks; ///< Blocks of a compressed file by offset
+    std::map<std::string, std::streamoff> mFirsts; ///< Offset of each block of a compressed file by the name of its first key
+    mutable std::streamoff  mCached;        ///< Offset of the block kept in mBlock, -1 if none
+    mutable std::string     mBlock;         ///< Last block read from a compressed file
+    mutable std::atomic<bool> mComplete;    ///< False while the keys of a compressed file are found block by block, until complete() indexes them all
+    std::map<std::size_t, Secondary> mSecondary; ///< Secondary indexes by position of the value
+    std::shared_ptr<Blobs>  mBlobs;         ///< Strings stored out of line, if any
+    std::function<bool()>   mPinned;        ///< Returns true while snapshots or mapped drawers of the room hold the file, which isn't modified in place then
+};
+
+////////////////////////////////////////////////////////////
+/// \brief Stream whose keys have values of types known at
+/// compile time, read straight into records
+///
+/// Reads skip the values of Key and the guessing of their
+/// types, writes go through the stream and keep its modes,
+/// transactions and journal.
+///
+////////////////////////////////////////////////////////////
+template<typename... Ts>
+class TypedStream
+{
+public:
+    ////////////////////////////////////////////////////////////
+    /// \brief Type the keys of a stream
+    ///
+    /// \param stream Stream, must outlive the typed stream
+    ///
+    ////////////////////////////////////////////////////////////
+    explicit    TypedStream(Stream& stream) : mStream(stream)
+    {
+
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Read a key, several threads may read at once as
+    /// long as none of them modifies the stream
+    ///
+    /// \param name Name of the key to read
+    ///
+    /// \return Record, empty if the key doesn't exist
+    ///
+    ////////////////////////////////////////////////////////////
+    std::optional<Record<Ts...>> read(const std::string& name) const
+    {
+        std::optional<Record<Ts...>> record;
+
+        if(mStream.contains(name))
+        {
+            record.emplace();
+            record->name = name;
+
+            mStream.fill(name, *record);
+        }
+
+        return record;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Write a record to the stream
+    ///
+    /// \param record Record to write
+    ///
+    ////////////////////////////////////////////////////////////
+    void        write(const Record<Ts...>& record)
+    {
+        mStream.write(record.key());
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Write values to the stream
+    ///
+    /// \param name Name of the key
+    /// \param values Values of the key
+    ///
+    ////////////////////////////////////////////////////////////
+    void        write(const std::string& name, const Ts&... values)
+    {
+        write(Record<Ts...>{name, {values...}});
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Visit every key of the stream in one pass over the
+    /// file, in the order of the file, followed by the writes of
+    /// the transaction
+    ///
+    /// \param visitor Function called with each record, returns
+    /// false to stop
+    ///
+    /// \return True if every key was visited
+    ///
+    ////////////////////////////////////////////////////////////
+    bool        for_each(const std::function<bool(const Record<Ts...>&)>& visitor) const
+    {
+        return mStream.visit(visitor);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the stream
+    ///
+    /// \return Stream
+    ///
+    ////////////////////////////////////////////////////////////
+    Stream&     stream() const
+    {
+        return mStream;
+    }
+
+private:
+    ////////////////////////////////////////////////////////////
+    // Member data
+    ////////////////////////////////////////////////////////////
+    Stream&     mStream;    ///< Stream
+};
+
+////////////////////////////////////////////////////////////
+/// \brief Class that views a key inside a mapped drawer
+/// without copying it, valid as long as the drawer is
+///
+////////////////////////////////////////////////////////////
+class KeyView
+{
+public:
+    ////////////////////////////////////////////////////////////
+    /// \brief Construct a view of a key that doesn't exist
+    ///
+    /// \param name Name of the key
+    ///
+    ////////////////////////////////////////////////////////////
+                KeyView(std::string_view name = {}) : mName(name), mValues(), mEncoding(Encoding::Text)
+    {
+
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Construct a view of a key
+    ///
+    /// \param name Name of the key
+    /// \param values Encoded values
+    /// \param encoding Encoding of the drawer
+    ///
+    ////////////////////////////////////////////////////////////
+                KeyView(std::string_view name, std::string_view values, Encoding encoding) : mName(name), mValues(values), mEncoding(encoding)
+    {
+
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the name of the key
+    ///
+    /// \return Name
+    ///
+    ////////////////////////////////////////////////////////////
+    std::string_view name() const
+    {
+        return mName;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the number of values
+    ///
+    /// \return Number of values, 0 if the key doesn't exist
+    ///
+    ////////////////////////////////////////////////////////////
+    std::size_t size() const
+    {
+        std::size_t count = 0;
+
+        if(mEncoding != Encoding::Text)
+        {
+            std::string_view cursor = mValues;
+
+            count = Codec::get<std::uint32_t>(cursor);
+        }
+        else if(mValues.data())
+        {
+            count = static_cast<std::size_t>(std::count(mValues.begin(), mValues.end(), ',')) + 1;
+        }
+
+        return count;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Overload of operator [] to retreive a value by index
+    ///
+    /// \param index Index of the value
+    ///
+    /// \return Value, strings view the drawer
+    ///
+    ////////////////////////////////////////////////////////////
+    Views       operator [](std::size_t index) const
+    {
+        std::optional<Views> found;
+
+        std::size_t i = 0;
+
+        for_each([&](const Views& value)
+        {
+            if(i++ == index)
+            {
+                found = value;
+            }
+        });
+
+        if(!found)
+        {
+            throw std::out_of_range("Key \"" + std::string(mName) + "\" has no value at index " + std::to_string(index));
+        }
+
+        return *found;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Call a function on each value, in order
+    ///
+    /// \param function Function taking a Views
+    ///
+    ////////////////////////////////////////////////////////////
+    template <typename Function>
+    void        for_each(Function function) const
+    {
+        if(mEncoding != Encoding::Text)
+        {
+            std::string_view cursor = mValues;
+
+            std::size_t count = Codec::get<std::uint32_t>(cursor);
+
+            for(std::size_t i = 0; i < count; ++i)
+            {
+                function(Codec::take(cursor));
+            }
+        }
+        else if(mValues.data())
+        {
+            std::size_t last = 0;
+
+            bool done = false;
+            while(!done)
+            {
+                auto pos = mValues.find(',', last);
+
+                function(Codec::value(mValues.substr(last, pos == std::string_view::npos ? pos : pos - last)));
+
+                if(pos != std::string_view::npos)
+                {
+                    last = pos + 1;
+                }
+                else
+                {
+                    done = true;
+                }
+            }
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Copy the view to a key that owns its values
+    ///
+    /// \return Key
+    ///
+    ////////////////////////////////////////////////////////////
+    Key         key() const
+    {
+        Key key{std::string(mName), {}};
+
+        for_each([&key](const Views& value)
+        {
+            key.values.push_back(Codec::own(value));
+        });
+
+        return key;
+    }
+
+private:
+    ////////////////////////////////////////////////////////////
+    // Member data
+    ////////////////////////////////////////////////////////////
+    std::string_view    mName;      ///< Name of the key
+    std::string_view    mValues;    ///< Encoded values, null if the key doesn't exist in a text drawer
+    Encoding            mEncoding;  ///< Encoding of the drawer
+};
+
+////////////////////////////////////////////////////////////
+/// \brief Read-only drawer mapped in memory once, lookups
+/// return views without copying nor reading the file again
+///
+////////////////////////////////////////////////////////////
+class MappedDrawer
+{
+public:
+    ////////////////////////////////////////////////////////////
+    /// \brief Map a drawer and index its keys
+    ///
+    /// \param file Path to the file, must exist
+    ///
+    ////////////////////////////////////////////////////////////
+                MappedDrawer(const std::filesystem::path& file) : mData(nullptr), mSize(0), mEncoding(Encoding::Text), mComplete(true)
+    {
+        map(file);
+        index();
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Move constructor
+    ///
+    ////////////////////////////////////////////////////////////
+                MappedDrawer(MappedDrawer&& other) noexcept : mData(std::exchange(other.mData, nullptr)), mSize(std::exchange(other.mSize, 0)), mBuffer(std::move(other.mBuffer)), mEncoding(other.mEncoding), mNames(std::move(other.mNames)), mTable(std::move(other.mTable)), mBlocks(std::move(other.mBlocks)), mIndex(std::move(other.mIndex)), mComplete(other.mComplete.load()), mPin(std::move(other.mPin))
+    {
+
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Move assignment
+    ///
+    ////////////////////////////////////////////////////////////
+    MappedDrawer& operator =(MappedDrawer&& other) noexcept
+    {
+        if(this != &other)
+        {
+            unmap();
+
+            mData = std::exchange(other.mData, nullptr);
+            mSize = std::exchange(other.mSize, 0);
+            mBuffer = std::move(other.mBuffer);
+            mEncoding = other.mEncoding;
+            mNames = std::move(other.mNames);
+            mTable = std::move(other.mTable);
+            mBlocks = std::move(other.mBlocks);
+            mIndex = std::move(other.mIndex);
+            mComplete = other.mComplete.load();
+            mPin = std::move(other.mPin);
+        }
+
+        return *this;
+    }
+
+                MappedDrawer(const MappedDrawer&) = delete;
+    MappedDrawer& operator =(const MappedDrawer&) = delete;
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Destructor, unmaps the drawer
+    ///
+    ////////////////////////////////////////////////////////////
+                ~MappedDrawer()
+    {
+        unmap();
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Read a key without copying it
+    ///
+    /// \param name Name of the key to read
+    ///
+    /// \return View of the key, without values if it doesn't
+    /// exist
+    ///
+    ////////////////////////////////////////////////////////////
+    KeyView     read(std::string_view name) const
+    {
+        std::string_view found;
+        std::string_view values;
+
+        return search(name, found, values) ? KeyView(found, values, mEncoding) : KeyView(name);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Check if a key exists
+    ///
+    /// \param name Name of the key
+    ///
+    /// \return True if the key exists
+    ///
+    ////////////////////////////////////////////////////////////
+    bool        contains(std::string_view name) const
+    {
+        std::string_view found;
+        std::string_view values;
+
+        return search(name, found, values);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Visit every key of the drawer, in no particular
+    /// order
+    ///
+    /// \param visitor Function called with the view of each key,
+    /// returns false to stop
+    ///
+    /// \return True if every key was visited
+    ///
+    ////////////////////////////////////////////////////////////
+    bool        for_each(const std::function<bool(const KeyView&)>& visitor) const
+    {
+        complete();
+
+        bool done = false;
+
+        for(auto it = mIndex.begin(); it != mIndex.end() && !done; ++it)
+        {
+            done = !visitor(KeyView(it->first, it->second, mEncoding));
+        }
+
+        return !done;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the number of keys
+    ///
+    /// \return Number of keys
+    ///
+    ////////////////////////////////////////////////////////////
+    std::size_t size() const
+    {
+        complete();
+
+        return mIndex.size();
+    }
+
+private:
+    friend class Room;
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Map the file, or read it in a buffer where memory
+    /// mapping isn't available
+    ///
+    /// \param file Path to the file
+    ///
+    ////////////////////////////////////////////////////////////
+    void        map(const std::filesystem::path& file)
+    {
+        if(!std::filesystem::is_regular_file(file))
+        {
+            throw std::runtime_error("Path \"" + file.string() + "\" doesn't point to any file");
+        }
+
+#if defined(__unix__) || defined(__APPLE__)
+        int descriptor = ::open(file.c_str(), O_RDONLY);
+
+        if(descriptor < 0)
+        {
+            throw std::runtime_error("Failed to map file on \"" + file.string() + "\"");
+        }
+
+        struct stat status{};
+
+        if(::fstat(descriptor, &status) == 0 && status.st_size > 0)
+        {
+            void* data = ::mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+
+            if(data != MAP_FAILED)
+            {
+                mData = static_cast<const char*>(data);
+                mSize = static_cast<std::size_t>(status.st_size);
+            }
+        }
+
+        ::close(descriptor);
+
+        if(!mData && status.st_size > 0)
+        {
+            throw std::runtime_error("Failed to map file on \"" + file.string() + "\"");
+        }
+#else
+        std::ifstream reader(file, std::ios_base::in | std::ios_base::binary);
+
+        mBuffer.assign(std::istreambuf_iterator<char>(reader), std::istreambuf_iterator<char>());
+
+        mData = mBuffer.data();
+        mSize = mBuffer.size();
+#endif
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Unmap the file
+    ///
+    ////////////////////////////////////////////////////////////
+    void        unmap()
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        if(mData)
+        {
+            ::munmap(const_cast<char*>(mData), mSize);
+        }
+#endif
+
+        mData = nullptr;
+        mSize = 0;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Detect the encoding and store the values of every
+    /// key, the last record of a key wins and a removal record
+    /// removes the key
+    ///
+    /// Only the index of the blocks of a compressed drawer is
+    /// read, its keys are found block by block until complete()
+    /// indexes them all.
+    ///
+    ////////////////////////////////////////////////////////////
+    void        index()
+    {
+        std::string_view content(mData, mSize);
+
+        mEncoding = Codec::detect(content);
+
+        if(mEncoding == Encoding::Compressed)
+        {
+            std::uint64_t offset = Codec::trailer(content.substr(content.size() - std::min<std::size_t>(content.size(), 16)), content.size());
+
+            bool sorted = true;
+
+            for(auto& it: Codec::blocks(content.substr(offset, content.size() - 16 - offset)))
+            {
+                if(it.offset < Codec::header().size() || it.offset + it.packed > offset)
+                {
+                    throw std::runtime_error("Corrupted compressed drawer");
+                }
+
+                sorted = sorted && (mTable.empty() || mTable.back().first < it.first);
+
+                mTable.push_back(std::move(it));
+            }
+
+            mComplete = false;
+
+            if(!sorted)
+            {
+                complete();
+            }
+        }
+        else
+        {
+            insert(content.substr(Codec::origin(mEncoding)));
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Store the values of the keys of a part of the
+    /// drawer, the whole content or a decompressed block
+    ///
+    /// \param part Records
+    ///
+    ////////////////////////////////////////////////////////////
+    void        insert(std::string_view part) const
+    {
+        std::size_t position = 0;
+
+        Codec::Record record;
+        while(Codec::next(part, position, mEncoding, record))
+        {
+            if(record.removed)
+            {
+                mIndex.erase(record.name);
+            }
+            else if(record.name.data() == record.unescaped.data())
+            {
+                auto found = mIndex.find(record.name);
+
+                if(found != mIndex.end())
+                {
+                    found->second = record.values;
+                }
+                else
+                {
+                    mNames.push_back(record.unescaped);
+                    mIndex[mNames.back()] = record.values;
+                }
+            }
+            else
+            {
+                mIndex[record.name] = record.values;
+            }
+
+            position += record.size;
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Find the values of a key
+    ///
+    /// Until complete() indexes the keys of a compressed drawer,
+    /// the block of the key is found by a binary search of the
+    /// first keys of the blocks and decompressed if it wasn't.
+    ///
+    /// \param name Name of the key
+    /// \param found View of the name in the drawer to fill
+    /// \param values View of the encoded values to fill
+    ///
+    /// \return True if the key exists
+    ///
+    ////////////////////////////////////////////////////////////
+    bool        search(std::string_view name, std::string_view& found, std::string_view& values) const
+    {
+        bool exists = false;
+
+        if(mComplete)
+        {
+            auto it = mIndex.find(name);
+
+            if(it != mIndex.end())
+            {
+                found = it->first;
+                values = it->second;
+                exists = true;
+            }
+        }
+        else
+        {
+            auto block = std::upper_bound(mTable.begin(), mTable.end(), name, [](std::string_view name, const Codec::Block& it){ return name < it.first; });
+
+            if(block != mTable.begin())
+            {
+                std::string_view raw = decompress(static_cast<std::size_t>(block - mTable.begin()) - 1);
+
+                std::size_t position = 0;
+
+                Codec::Record record;
+                while(!exists && Codec::next(raw, position, mEncoding, record))
+                {
+                    if(record.name == name)
+                    {
+                        found = record.name;
+                        values = record.values;
+                        exists = true;
+                    }
+
+                    position += record.size;
+                }
+            }
+        }
+
+        return exists;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get a block of a compressed drawer, decompressed
+    /// the first time only
+    ///
+    /// \param block Number of the block
+    ///
+    /// \return Records of the block, valid as long as the drawer
+    ///
+    ////////////////////////////////////////////////////////////
+    std::string_view decompress(std::size_t block) const
+    {
+        std::lock_guard<std::mutex> lock(mUnpacking);
+
+        auto found = mBlocks.find(block);
+
+        if(found == mBlocks.end())
+        {
+            std::string raw;
+
+            Codec::decompress(std::string_view(mData, mSize).substr(mTable[block].offset, mTable[block].packed), mTable[block].size, raw);
+
+            found = mBlocks.emplace(block, std::move(raw)).first;
+        }
+
+        return found->second;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Index every key of a compressed drawer found so far
+    /// block by block, decompressing the blocks that weren't
+    ///
+    ////////////////////////////////////////////////////////////
+    void        complete() const
+    {
+        if(!mComplete)
+        {
+            std::lock_guard<std::mutex> lock(mIndexing);
+
+            if(!mComplete)
+            {
+                for(std::size_t i = 0; i < mTable.size(); ++i)
+                {
+                    insert(decompress(i));
+                }
+
+                mComplete = true;
+            }
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    // Member data
+    ////////////////////////////////////////////////////////////
+    const char*     mData;      ///< Mapped content
+    std::size_t     mSize;      ///< Size of the content
+    std::vector<char> mBuffer;  ///< Content read where mapping isn't available, its data doesn't move with the drawer
+    Encoding        mEncoding;  ///< Encoding of the drawer
+    mutable std::list<std::string> mNames; ///< Names unescaped out of the content
+    std::vector<Codec::Block> mTable; ///< Blocks of a compressed drawer, in the order of their first keys
+    mutable std::map<std::size_t, std::string> mBlocks; ///< Blocks of a compressed drawer decompressed so far, by number
+    mutable std::unordered_map<std::string_view, std::string_view> mIndex; ///< Values of each key, of a compressed drawer once complete() ran
+    mutable std::atomic<bool> mComplete; ///< False while the keys of a compressed drawer are found block by block
+    mutable std::mutex mUnpacking;  ///< Lock of the blocks decompressed so far
+    mutable std::mutex mIndexing;   ///< Lock of the index while complete() builds it
+    std::shared_ptr<const void> mPin; ///< Held while mapped by a room, so the room doesn't patch the file in place
+};
+
+////////////////////////////////////////////////////////////
+/// \brief Advisory lock shared between processes, held on a
+/// file beside a drawer which also counts the modifications
+/// of the drawer
+///
+////////////////////////////////////////////////////////////
+class FileLock
+{
+public:
+    ////////////////////////////////////////////////////////////
+    static constexpr std::uint64_t unknown = ~std::uint64_t(0); ///< Generation that never matches the lock file
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Open the lock file, create it if needed
+    ///
+    /// \param file Path to the lock file
+    ///
+    ////////////////////////////////////////////////////////////
+                FileLock(const std::filesystem::path& file) : mDescriptor(-1), mGeneration(0)
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        mDescriptor = ::open(file.c_str(), O_RDWR | O_CREAT, 0644);
+
+        if(mDescriptor < 0)
+        {
+            throw std::runtime_error("Failed to open lock file on \"" + file.string() + "\"");
+        }
+#else
+        throw std::runtime_error("Locking between processes isn't available on this platform");
+#endif
+    }
+
+                FileLock(const FileLock&) = delete;
+    FileLock&   operator =(const FileLock&) = delete;
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Destructor, closes the lock file
+    ///
+    ////////////////////////////////////////////////////////////
+                ~FileLock()
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        if(mDescriptor >= 0)
+        {
+            ::close(mDescriptor);
+        }
+#endif
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Wait for the lock
+    ///
+    /// \param exclusive True to lock for writing, false to share
+    /// the lock with other readers
+    ///
+    /// \return Number of modifications of the drawer
+    ///
+    ////////////////////////////////////////////////////////////
+    std::uint64_t lock(bool exclusive)
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        while(::flock(mDescriptor, exclusive ? LOCK_EX : LOCK_SH) != 0)
+        {
+            if(errno != EINTR)
+            {
+                throw std::runtime_error("Failed to lock drawer");
+            }
+        }
+
+        char bytes[8] = {};
+
+        if(::pread(mDescriptor, bytes, sizeof(bytes), 0) == static_cast<ssize_t>(sizeof(bytes)))
+        {
+            std::string_view cursor(bytes, sizeof(bytes));
+
+            mGeneration = Codec::get<std::uint64_t>(cursor);
+        }
+#endif
+
+        return mGeneration;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Release the lock
+    ///
+    /// \param modified True if the drawer was modified, which
+    /// counts one more modification
+    ///
+    /// \return Number of modifications of the drawer
+    ///
+    ////////////////////////////////////////////////////////////
+    std::uint64_t unlock(bool modified)
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        if(modified)
+        {
+            std::string bytes;
+            Codec::put<std::uint64_t>(bytes, ++mGeneration);
+
+            if(::pwrite(mDescriptor, bytes.data(), bytes.size(), 0) != static_cast<ssize_t>(bytes.size()))
+            {
+                mGeneration = unknown;
+            }
+        }
+
+        ::flock(mDescriptor, LOCK_UN);
+#endif
+
+        return mGeneration;
+    }
+
+private:
+    ////////////////////////////////////////////////////////////
+    // Member data
+    ////////////////////////////////////////////////////////////
+    int             mDescriptor;    ///< Descriptor of the lock file
+    std::uint64_t   mGeneration;    ///< Number of modifications of the drawer
+};
+
+////////////////////////////////////////////////////////////
+/// \brief Cache of decoded keys shared by the threads of a
+/// room, bounded by a memory budget
+///
+/// Keys are spread over shards by drawer and name, each shard
+/// evicts with the CLOCK policy: a hit only marks its entry and
+/// the hand of the shard spares a marked entry once. Every
+/// drawer has a generation, bumped when it is modified, an entry
+/// read at an older generation is stale.
+///
+////////////////////////////////////////////////////////////
+class Cache
+{
+public:
+    ////////////////////////////////////////////////////////////
+    /// \brief Counters of the cache
+    ///
+    ////////////////////////////////////////////////////////////
+    struct Counters
+    {
+        std::uint64_t   hits = 0;           ///< Reads served by the cache
+        std::uint64_t   misses = 0;         ///< Reads left to the drawers
+        std::uint64_t   evictions = 0;      ///< Entries evicted to stay within the budget
+        std::uint64_t   invalidations = 0;  ///< Stale entries dropped
+        std::size_t     entries = 0;        ///< Entries kept
+        std::size_t     bytes = 0;          ///< Estimated memory used by the entries
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Generation of a drawer, taken while the drawer is
+    /// locked to read it
+    ///
+    ////////////////////////////////////////////////////////////
+    struct Version
+    {
+        std::shared_ptr<const std::atomic<std::uint64_t>> generation; ///< Generation of the drawer
+        std::uint64_t   seen = 0;   ///< Value of the generation when taken
+    };
+
+    ////////////////////////////////////////////////////////////
+    static constexpr std::size_t shards = 16; ///< Number of shards
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Default constructor, the cache is disabled
+    ///
+    ////////////////////////////////////////////////////////////
+                Cache() : mCapacity(0)
+    {
+
+    }
+
+                Cache(const Cache&) = delete;
+    Cache&      operator =(const Cache&) = delete;
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Set the memory budget, shared evenly between the
+    /// shards
+    ///
+    /// \param bytes Budget in bytes, 0 to disable the cache
+    ///
+    ////////////////////////////////////////////////////////////
+    void        set_capacity(std::size_t bytes)
+    {
+        mCapacity = bytes;
+
+        if(bytes == 0)
+        {
+            invalidate(".");
+        }
+
+        for(auto& it: mShards)
+        {
+            std::lock_guard<std::mutex> lock(it.mutex);
+
+            evict(it, bytes / shards);
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the memory budget
+    ///
+    /// \return Budget in bytes, 0 if the cache is disabled
+    ///
+    ////////////////////////////////////////////////////////////
+    std::size_t capacity() const
+    {
+        return mCapacity;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Find a key read before, dropping it if the drawer
+    /// was modified since
+    ///
+    /// \param drawer Normalized path to the drawer
+    /// \param name Name of the key
+    /// \param key Key to fill
+    ///
+    /// \return True if the key was found
+    ///
+    ////////////////////////////////////////////////////////////
+    bool        find(const std::string& drawer, const std::string& name, Key& key)
+    {
+        std::string id = identify(drawer, name);
+
+        Shard& shard = mShards[std::hash<std::string>()(id) % shards];
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        bool found = false;
+
+        auto it = shard.index.find(id);
+
+        if(it != shard.index.end())
+        {
+            Entry& entry = *it->second;
+
+            if(*entry.version.generation == entry.version.seen)
+            {
+                key = entry.key;
+                entry.referenced = true;
+
+                found = true;
+            }
+            else
+            {
+                drop(shard, it->second);
+
+                ++shard.counters.invalidations;
+            }
+        }
+
+        ++(found ? shard.counters.hits : shard.counters.misses);
+
+        return found;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the generation of a drawer, to take while the
+    /// drawer is locked before reading a key to insert
+    ///
+    /// \param drawer Normalized path to the drawer
+    ///
+    /// \return Generation of the drawer
+    ///
+    ////////////////////////////////////////////////////////////
+    Version     version(const std::string& drawer)
+    {
+        std::lock_guard<std::mutex> lock(mVersioning);
+
+        std::shared_ptr<std::atomic<std::uint64_t>>& generation = mGenerations[drawer];
+
+        if(!generation)
+        {
+            generation = std::make_shared<std::atomic<std::uint64_t>>(0);
+        }
+
+        return Version{generation, generation->load()};
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Insert a key read from a drawer, unless the drawer
+    /// was modified since the version was taken or the key is
+    /// larger than the budget of a shard
+    ///
+    /// \param drawer Normalized path to the drawer
+    /// \param key Key read
+    /// \param version Generation of the drawer when the key was
+    /// read
+    ///
+    ////////////////////////////////////////////////////////////
+    void        insert(const std::string& drawer, const Key& key, const Version& version)
+    {
+        std::string id = identify(drawer, key.name);
+
+        std::size_t size = footprint(id, key);
+
+        Shard& shard = mShards[std::hash<std::string>()(id) % shards];
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        std::size_t budget = mCapacity / shards;
+
+        if(size <= budget && *version.generation == version.seen)
+        {
+            auto found = shard.index.find(id);
+
+            if(found != shard.index.end())
+            {
+                drop(shard, found->second);
+            }
+
+            evict(shard, budget - size);
+
+            auto it = shard.entries.insert(shard.hand, Entry{id, key, version, size, false});
+
+            shard.index.emplace(std::move(id), it);
+            shard.bytes += size;
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Make the keys of a drawer, or of the drawers of a
+    /// directory, stale
+    ///
+    /// \param name Normalized path to the drawer or directory,
+    /// "." for every drawer
+    ///
+    ////////////////////////////////////////////////////////////
+    void        invalidate(const std::string& name)
+    {
+        std::lock_guard<std::mutex> lock(mVersioning);
+
+        if(name == ".")
+        {
+            for(auto& it: mGenerations)
+            {
+                ++*it.second;
+            }
+        }
+        else
+        {
+            auto found = mGenerations.find(name);
+
+            if(found != mGenerations.end())
+            {
+                ++*found->second;
+            }
+
+            std::string directory = name + '/';
+
+            for(auto it = mGenerations.lower_bound(directory); it != mGenerations.end() && it->first.compare(0, directory.size(), directory) == 0; ++it)
+            {
+                ++*it->second;
+            }
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the counters of the cache
+    ///
+    /// \return Counters summed over the shards
+    ///
+    ////////////////////////////////////////////////////////////
+    Counters    counters()
+    {
+        Counters total;
+
+        for(auto& it: mShards)
+        {
+            std::lock_guard<std::mutex> lock(it.mutex);
+
+            total.hits += it.counters.hits;
+            total.misses += it.counters.misses;
+            total.evictions += it.counters.evictions;
+            total.invalidations += it.counters.invalidations;
+            total.entries += it.index.size();
+            total.bytes += it.bytes;
+        }
+
+        return total;
+    }
+
+private:
+    ////////////////////////////////////////////////////////////
+    /// \brief Key kept in a shard
+    ///
+    ////////////////////////////////////////////////////////////
+    struct Entry
+    {
+        std::string id;         ///< Drawer and name of the key
+        Key         key;        ///< Decoded key
+        Version     version;    ///< Generation of the drawer when the key was read
+        std::size_t size;       ///< Estimated memory used by the entry
+        bool        referenced; ///< True if hit since the hand last passed
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Part of the cache under its own lock
+    ///
+    ////////////////////////////////////////////////////////////
+    struct Shard
+    {
+        std::mutex              mutex;      ///< Lock of the shard
+        std::list<Entry>        entries;    ///< Clock of the entries
+        std::list<Entry>::iterator hand = entries.end(); ///< Next entry the clock considers evicting
+        std::unordered_map<std::string, std::list<Entry>::iterator> index; ///< Entries by drawer and name
+        std::size_t             bytes = 0;  ///< Estimated memory used by the entries
+        Counters                counters;   ///< Counters of the shard
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Identify a key across drawers
+    ///
+    /// \param drawer Normalized path to the drawer
+    /// \param name Name of the key
+    ///
+    /// \return Drawer and name separated by a null character
+    ///
+    ////////////////////////////////////////////////////////////
+    static std::string identify(const std::string& drawer, const std::string& name)
+    {
+        std::string id;
+        id.reserve(drawer.size() + 1 + name.size());
+
+        id += drawer;
+        id += '\0';
+        id += name;
+
+        return id;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Estimate the memory used by an entry
+    ///
+    /// \param id Drawer and name of the key
+    /// \param key Decoded key
+    ///
+    /// \return Size in bytes, the index and the nodes included
+    ///
+    ////////////////////////////////////////////////////////////
+    static std::size_t footprint(const std::string& id, const Key& key)
+    {
+        std::size_t size = sizeof(Entry) + 4 * sizeof(void*) + 2 * id.size() + key.name.size() + key.values.capacity() * sizeof(Types);
+
+        for(const auto& it: key.values)
+        {
+            if(const std::string* value = std::get_if<std::string>(&it))
+            {
+                size += value->capacity();
+            }
+        }
+
+        return size;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Remove an entry from its shard
+    ///
+    /// \param shard Shard, locked
+    /// \param entry Entry to remove
+    ///
+    ////////////////////////////////////////////////////////////
+    static void drop(Shard& shard, std::list<Entry>::iterator entry)
+    {
+        if(shard.hand == entry)
+        {
+            ++shard.hand;
+        }
+
+        shard.bytes -= entry->size;
+        shard.index.erase(entry->id);
+        shard.entries.erase(entry);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Turn the hand of a shard until its entries fit a
+    /// budget, sparing once the entries hit since it last passed
+    ///
+    /// \param shard Shard, locked
+    /// \param budget Budget in bytes
+    ///
+    ////////////////////////////////////////////////////////////
+    static void evict(Shard& shard, std::size_t budget)
+    {
+        while(shard.bytes > budget)
+        {
+            if(shard.hand == shard.entries.end())
+            {
+                shard.hand = shard.entries.begin();
+            }
+
+            if(shard.hand->referenced)
+            {
+                shard.hand->referenced = false;
+
+                ++shard.hand;
+            }
+            else
+            {
+                drop(shard, shard.hand);
+
+                ++shard.counters.evictions;
+            }
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    // Member data
+    ////////////////////////////////////////////////////////////
+    std::atomic<std::size_t> mCapacity;     ///< Memory budget in bytes, 0 if disabled
+    std::array<Shard, shards> mShards;      ///< Shards of the entries
+    std::mutex              mVersioning;    ///< Lock of the generations
+    std::map<std::string, std::shared_ptr<std::atomic<std::uint64_t>>> mGenerations; ///< Generation of each drawer read, kept while the cache lives
+};
+
+////////////////////////////////////////////////////////////
+/// \brief Consistent view of drawers of a room at one point in
+/// time, made by Room::snapshot()
+///
+/// Each drawer is a mapped version of its file. Rewrites rename
+/// a new file over the drawer and appends stay past the mapped
+/// end, so writers never wait for a snapshot nor change what it
+/// sees. Snapshots of the same version share it, and a version
+/// is released with the last snapshot holding it.
+///
+////////////////////////////////////////////////////////////
+class Snapshot
+{
+public:
+    ////////////////////////////////////////////////////////////
+    /// \brief Get a drawer of the snapshot
+    ///
+    /// \param file Path to the file, must be part of the
+    /// snapshot
+    ///
+    /// \return Mapped drawer
+    ///
+    ////////////////////////////////////////////////////////////
+    const MappedDrawer& drawer(const std::filesystem::path& file) const
+    {
+        auto found = mDrawers.find(Stream::normalize(file));
+
+        if(found == mDrawers.end())
+        {
+            throw std::runtime_error("Path \"" + file.string() + "\" isn't part of the snapshot");
+        }
+
+        return *found->second;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Read a key of a drawer as it was when the snapshot
+    /// was taken
+    ///
+    /// \param file Path to the file, must be part of the
+    /// snapshot
+    /// \param name Name of the key to read
+    ///
+    /// \return Key, without values if it didn't exist
+    ///
+    ////////////////////////////////////////////////////////////
+    Key         read(const std::filesystem::path& file, const std::string& name) const
+    {
+        Key key = drawer(file).read(name).key();
+
+        auto found = mBlobs.find(Stream::normalize(file));
+
+        if(found != mBlobs.end())
+        {
+            for(auto& it: key.values)
+            {
+                if(std::string* string = std::get_if<std::string>(&it))
+                {
+                    found->second->resolve(*string);
+                }
+            }
+        }
+
+        return key;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Check if a drawer is part of the snapshot
+    ///
+    /// \param file Path to the file
+    ///
+    /// \return True if the snapshot holds the drawer
+    ///
+    ////////////////////////////////////////////////////////////
+    bool        contains(const std::filesystem::path& file) const
+    {
+        return mDrawers.count(Stream::normalize(file)) > 0;
+    }
+
+private:
+    friend class Room;
+
+    ////////////////////////////////////////////////////////////
+    // Member data
+    ////////////////////////////////////////////////////////////
+    std::map<std::string, std::shared_ptr<const MappedDrawer>> mDrawers; ///< Version of each drawer, by normalized path
+    std::map<std::string, std::shared_ptr<const Blobs>> mBlobs; ///< Blobs of each drawer holding some, by normalized path
+};
+
+////////////////////////////////////////////////////////////
+/// \brief Stream wrapper class for a locker-room type
+/// database based on files
+///
+////////////////////////////////////////////////////////////
+class Room
+{
+public:
+    ////////////////////////////////////////////////////////////
+    /// \brief Progress of a bulk load or export
+    ///
+    ////////////////////////////////////////////////////////////
+    struct Progress
+    {
+        std::uint64_t   records = 0;    ///< Records read from the dump, or written to it
+        std::size_t     drawers = 0;    ///< Drawers written, or read
+        std::size_t     total = 0;      ///< Drawers to write or read, 0 while unknown
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Default constructor
+    ///
+    ////////////////////////////////////////////////////////////
+            Room() : mBase(std::filesystem::current_path()), mMode(Stream::Mode::Rewrite), mThreshold(0.5), mOutline(0), mEncoding(Encoding::Text), mCapacity(64), mProcess(false), mDurability(Durability::None), mStale(0), mCacheSize(0), mStopping(false)
+    {
+        //ctor
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Default destructor, serves the asynchronous
+    /// requests left before returning
+    ///
+    ////////////////////////////////////////////////////////////
+            ~Room()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mExecuting);
+
+            mStopping = true;
+        }
+
+        mWaking.notify_all();
+
+        for(auto& it: mWorkers)
+        {
+            it.join();
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Set the base directory, current path by default,
+    /// and replay the journals left there by rooms which didn't
+    /// close
+    ///
+    /// \param directory Path to the directory
+    /// \param create If true and directory doesn't exist create
+    /// a new one, false by default
+    ///
+    ////////////////////////////////////////////////////////////
+    void    connect(const std::filesystem::path& directory, bool create = false)
+    {
+        flush();
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        if(std::filesystem::exists(directory))
+        {
+            if(std::filesystem::is_directory(directory))
+            {
+                mBase = std::filesystem::absolute(directory);
+            }
+            else
+            {
+                throw std::runtime_error("Invalid path, must be a directory.");
+            }
+        }
+        else if(create)
+        {
+            std::filesystem::create_directories(directory);
+
+            mBase = std::filesystem::absolute(directory);
+        }
+        else
+        {
+            throw std::runtime_error("Path \"" + directory.string() + "\" doesn't point to any file");
+        }
+
+        mJournal.reset();
+        mRecorders.clear();
+
+        recover();
+
+        mCache.invalidate(".");
+
+        if(mDurability != Durability::None)
+        {
+            mJournal = std::make_shared<Journal>(mBase, mDurability);
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Set the way drawers store modifications,
+    /// Stream::Mode::Rewrite by default
+    ///
+    /// \param mode Stream::Mode::Append to append modifications
+    /// instead of rewriting drawers
+    ///
+    ////////////////////////////////////////////////////////////
+    void    set_mode(Stream::Mode mode)
+    {
+        for(const auto& it: drawers([this, mode](){ mMode = mode; }))
+        {
+            std::unique_lock<std::shared_mutex> lock(it->lock);
+
+            if(it->stream)
+            {
+                it->stream->set_mode(mode);
+            }
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Set the ratio of dead records above which
+    /// appending drawers are compacted, 0.5 by default
+    ///
+    /// \param threshold Ratio between 0 and 1
+    ///
+    ////////////////////////////////////////////////////////////
+    void    set_compaction_threshold(double threshold)
+    {
+        for(const auto& it: drawers([this, threshold](){ mThreshold = threshold; }))
+        {
+            std::unique_lock<std::shared_mutex> lock(it->lock);
+
+            if(it->stream)
+            {
+                it->stream->set_compaction_threshold(threshold);
+            }
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Set the size above which the drawers opened by the
+    /// room store strings as blobs, 0 by default
+    ///
+    /// \param bytes Size in bytes, 0 to keep every string in the
+    /// drawers
+    ///
+    ////////////////////////////////////////////////////////////
+    void    set_blob_threshold(std::size_t bytes)
+    {
+        for(const auto& it: drawers([this, bytes](){ mOutline = bytes; }))
+        {
+            std::unique_lock<std::shared_mutex> lock(it->lock);
+
+            if(it->stream)
+            {
+                it->stream->set_blob_threshold(bytes);
+            }
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Set the encoding of the drawers created by the
+    /// room, Encoding::Text by default
+    ///
+    /// \param encoding Encoding of new drawers
+    ///
+    ////////////////////////////////////////////////////////////
+    void    set_encoding(Encoding encoding)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        mEncoding = encoding;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Set the durability of the modifications made
+    /// through the room, Durability::None by default
+    ///
+    /// Other durabilities log modifications to a journal in the
+    /// base directory before applying them. Threads waiting for
+    /// the journal share its syncs, and connect() replays the
+    /// journals of rooms which didn't close. POSIX only.
+    ///
+    /// \param durability Durability::Batch to sync once per
+    /// operation, Durability::Write to sync before every write
+    ///
+    ////////////////////////////////////////////////////////////
+    void    set_durability(Durability durability)
+    {
+        std::shared_ptr<Journal> journal;
+
+        auto update = [this, durability, &journal]()
+        {
+            if(durability == Durability::None)
+            {
+                mJournal.reset();
+            }
+            else if(mJournal)
+            {
+                mJournal->set_durability(durability);
+            }
+            else
+            {
+                mJournal = std::make_shared<Journal>(mBase, durability);
+            }
+
+            mDurability = durability;
+            journal = mJournal;
+        };
+
+        for(const auto& it: drawers(update))
+        {
+            std::unique_lock<std::shared_mutex> lock(it->lock);
+
+            if(it->stream)
+            {
+                it->stream->mJournal = journal;
+            }
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Set the number of drawers the room keeps open
+    /// between calls, 64 by default
+    ///
+    /// Open drawers skip the filesystem checks and keep their
+    /// index. They assume the room is the only one modifying
+    /// them, call evict() or flush() after modifying a drawer
+    /// another way, or enable locking between processes.
+    ///
+    /// \param size Maximum number of open drawers, 0 to close
+    /// drawers after each call
+    ///
+    ////////////////////////////////////////////////////////////
+    void    set_pool_size(std::size_t size)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        mCapacity = size;
+
+        trim();
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Lock drawers between processes too, with advisory
+    /// locks on files kept beside them, false by default
+    ///
+    /// Open drawers notice modifications made by other processes
+    /// that lock them as well and reload their index. The cache of
+    /// quick_read() can't notice them, it is disabled while locking
+    /// between processes.
+    ///
+    /// \param enabled True to lock between processes
+    ///
+    ////////////////////////////////////////////////////////////
+    void    set_process_locking(bool enabled)
+    {
+#if !defined(__unix__) && !defined(__APPLE__)
+        if(enabled)
+        {
+            throw std::runtime_error("Locking between processes isn't available on this platform");
+        }
+#endif
+
+        flush();
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        mProcess = enabled;
+
+        mCache.set_capacity(mProcess ? 0 : mCacheSize);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Set the memory budget of the cache of the keys
+    /// read by quick_read(), 0 by default to disable it
+    ///
+    /// Modifications made through the room make the keys of the
+    /// drawer stale. The cache isn't coherent between processes:
+    /// it assumes the room is the only one modifying the drawers,
+    /// call evict() or flush() after modifying a drawer another
+    /// way. It is disabled while locking between processes, the
+    /// budget is kept for when locking stops.
+    ///
+    /// \param bytes Budget in bytes, estimated from the names and
+    /// values of the keys
+    ///
+    ////////////////////////////////////////////////////////////
+    void    set_cache_size(std::size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        mCacheSize = bytes;
+
+        mCache.set_capacity(mProcess ? 0 : mCacheSize);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the counters of the cache of the room
+    ///
+    /// \return Hits, misses, evictions and size of the cache
+    ///
+    ////////////////////////////////////////////////////////////
+    Cache::Counters cache_counters()
+    {
+        return mCache.counters();
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Close every open drawer, drawers in use are closed
+    /// when their operation ends, and empty the journal
+    ///
+    ////////////////////////////////////////////////////////////
+    void    flush()
+    {
+        evict(".");
+
+        std::shared_ptr<Journal> journal;
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            journal = mJournal;
+        }
+
+        if(journal)
+        {
+            journal->checkpoint();
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Close a drawer, or every drawer of a directory
+    ///
+    /// A drawer in use stays the only one on its file: it's
+    /// reloaded by the next operation and closed once released.
+    ///
+    /// \param file Path to the file or directory
+    ///
+    ////////////////////////////////////////////////////////////
+    void    evict(const std::filesystem::path& file)
+    {
+        std::string name = Stream::normalize(file);
+
+        mCache.invalidate(name);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        for(auto it = mRecent.begin(); it != mRecent.end();)
+        {
+            if(name == "." || it->name == name || it->name.compare(0, name.size() + 1, name + '/') == 0)
+            {
+                if(it->drawer.use_count() == 1)
+                {
+                    it = close(it);
+                }
+                else
+                {
+                    if(!it->drawer->stale.exchange(true))
+                    {
+                        ++mStale;
+                    }
+
+                    ++it;
+                }
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Open a drawer which contains keys to operate on,
+    /// a transaction left open by the function is discarded
+    ///
+    /// The drawer is locked for the duration of the function,
+    /// which must not use the room on the same drawer.
+    ///
+    /// \param file Path to the file
+    /// \param function Operations
+    /// \param create Create a new file if path doesn't point to
+    /// any, false by default
+    ///
+    ////////////////////////////////////////////////////////////
+    void    open(const std::filesystem::path& file, std::function<void(Stream&)> function, bool create = false)
+    {
+        Access access(*this, file, create, true);
+
+        try
+        {
+            function(access.stream());
+        }
+        catch(...)
+        {
+            evict(file);
+            throw;
+        }
+
+        access.stream().rollback();
+
+        access.commit();
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Open a drawer to read keys, other threads may read
+    /// the drawer at the same time
+    ///
+    /// \param file Path to the file, must exist
+    /// \param function Read operations
+    ///
+    ////////////////////////////////////////////////////////////
+    void    view(const std::filesystem::path& file, std::function<void(const Stream&)> function)
+    {
+        Access access(*this, file, false, false);
+
+        function(access.stream());
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Read a key on the executor of the room
+    ///
+    /// The executor queues requests by drawer, a thread serves
+    /// every request queued for a drawer in one pass: the drawer
+    /// is locked once and consecutive writes are applied as one
+    /// batch, which rewrites the file once.
+    ///
+    /// \param file Path to the file, must exist
+    /// \param name Name of the key
+    ///
+    /// \return Future key
+    ///
+    ////////////////////////////////////////////////////////////
+    std::future<Key> async_read(const std::filesystem::path& file, const std::string& name)
+    {
+        auto promise = std::make_shared<std::promise<Key>>();
+
+        Request request;
+        request.kind = Request::Kind::Read;
+        request.name = name;
+        request.done = [promise](Key&& key, std::exception_ptr error)
+        {
+            if(error)
+            {
+                promise->set_exception(error);
+            }
+            else
+            {
+                promise->set_value(std::move(key));
+            }
+        };
+
+        std::future<Key> future = promise->get_future();
+
+        submit(file, std::move(request));
+
+        return future;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Write a key on the executor of the room
+    ///
+    /// \param file Path to the file
+    /// \param key Key to write
+    /// \param create Create a new file if path doesn't point to
+    /// any, false by default
+    ///
+    /// \return Future ready once the key is written as durably as
+    /// the room requires
+    ///
+    ////////////////////////////////////////////////////////////
+    std::future<void> async_write(const std::filesystem::path& file, const Key& key, bool create = false)
+    {
+        Request request;
+        request.kind = Request::Kind::Write;
+        request.key = key;
+        request.create = create;
+
+        return submit(file, std::move(request), std::make_shared<std::promise<void>>());
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Open a drawer on the executor of the room and call
+    /// a function, a transaction left open by the function is
+    /// discarded
+    ///
+    /// The function runs on a thread of the executor and must not
+    /// wait for another request of the room.
+    ///
+    /// \param file Path to the file
+    /// \param function Operations
+    /// \param create Create a new file if path doesn't point to
+    /// any, false by default
+    ///
+    /// \return Future ready once the function returned, holding
+    /// its exception if it threw
+    ///
+    ////////////////////////////////////////////////////////////
+    std::future<void> async_open(const std::filesystem::path& file, std::function<void(Stream&)> function, bool create = false)
+    {
+        Request request;
+        request.kind = Request::Kind::Open;
+        request.function = std::move(function);
+        request.create = create;
+
+        return submit(file, std::move(request), std::make_shared<std::promise<void>>());
+    }
+
+#if defined(__cpp_impl_coroutine)
+    ////////////////////////////////////////////////////////////
+    /// \brief Awaitable request of the executor, resumes the
+    /// coroutine on a thread of the executor once served
+    ///
+    ////////////////////////////////////////////////////////////
+    template<typename Result>
+    class Awaitable
+    {
+    public:
+        using Completion = std::function<void(Key&&, std::exception_ptr)>; ///< Called when the request is served
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Construct an awaitable request
+        ///
+        /// \param submit Function queuing the request with a
+        /// completion
+        ///
+        ////////////////////////////////////////////////////////////
+        explicit    Awaitable(std::function<void(Completion)> submit) : mSubmit(std::move(submit))
+        {
+
+        }
+
+        ////////////////////////////////////////////////////////////
+        bool        await_ready() const noexcept
+        {
+            return false;
+        }
+
+        ////////////////////////////////////////////////////////////
+        void        await_suspend(std::coroutine_handle<> handle)
+        {
+            mSubmit([this, handle](Key&& key, std::exception_ptr error)
+            {
+                mKey = std::move(key);
+                mError = error;
+
+                handle.resume();
+            });
+        }
+
+        ////////////////////////////////////////////////////////////
+        Result      await_resume()
+        {
+            if(mError)
+            {
+                std::rethrow_exception(mError);
+            }
+
+            if constexpr(!std::is_void_v<Result>)
+            {
+                return std::move(mKey);
+            }
+        }
+
+    private:
+        ////////////////////////////////////////////////////////////
+        // Member data
+        ////////////////////////////////////////////////////////////
+        std::function<void(Completion)> mSubmit;    ///< Queues the request
+        Key                             mKey;       ///< Key read
+        std::exception_ptr              mError;     ///< Exception of the request, if any
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Read a key on the executor from a coroutine
+    ///
+    /// \param file Path to the file, must exist
+    /// \param name Name of the key
+    ///
+    /// \return Awaitable key
+    ///
+    ////////////////////////////////////////////////////////////
+    Awaitable<Key> co_read(const std::filesystem::path& file, const std::string& name)
+    {
+        return Awaitable<Key>([this, file, name](Awaitable<Key>::Completion done)
+        {
+            Request request;
+            request.kind = Request::Kind::Read;
+            request.name = name;
+            request.done = std::move(done);
+
+            submit(file, std::move(request));
+        });
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Write a key on the executor from a coroutine
+    ///
+    /// \param file Path to the file
+    /// \param key Key to write
+    /// \param create Create a new file if path doesn't point to
+    /// any, false by default
+    ///
+    /// \return Awaitable write
+    ///
+    ////////////////////////////////////////////////////////////
+    Awaitable<void> co_write(const std::filesystem::path& file, const Key& key, bool create = false)
+    {
+        return Awaitable<void>([this, file, key, create](Awaitable<void>::Completion done)
+        {
+            Request request;
+            request.kind = Request::Kind::Write;
+            request.key = key;
+            request.create = create;
+            request.done = std::move(done);
+
+            submit(file, std::move(request));
+        });
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Open a drawer on the executor from a coroutine and
+    /// call a function
+    ///
+    /// \param file Path to the file
+    /// \param function Operations
+    /// \param create Create a new file if path doesn't point to
+    /// any, false by default
+    ///
+    /// \return Awaitable call
+    ///
+    ////////////////////////////////////////////////////////////
+    Awaitable<void> co_open(const std::filesystem::path& file, std::function<void(Stream&)> function, bool create = false)
+    {
+        return Awaitable<void>([this, file, function, create](Awaitable<void>::Completion done)
+        {
+            Request request;
+            request.kind = Request::Kind::Open;
+            request.function = function;
+            request.create = create;
+            request.done = std::move(done);
+
+            submit(file, std::move(request));
+        });
+    }
+#endif
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Visit every key of the drawers of the room, each
+    /// drawer is read in one pass and drawers are spread over
+    /// several threads
+    ///
+    /// Directories of the room are walked recursively. The
+    /// visitor is called from several threads at once, the keys
+    /// of one drawer are visited by a single thread in the order
+    /// of the file.
+    ///
+    /// \param predicate Function called with the path of each
+    /// file, returns true to visit its keys
+    /// \param visitor Function called with the path of the file
+    /// and each key, returns false to stop the scan
+    /// \param threads Number of threads, 0 by default to use one
+    /// per hardware thread
+    ///
+    /// \return True if every key was visited
+    ///
+    ////////////////////////////////////////////////////////////
+    bool    scan(std::function<bool(const std::filesystem::path&)> predicate, std::function<bool(const std::filesystem::path&, const Key&)> visitor, std::size_t threads = 0)
+    {
+        std::vector<std::filesystem::path> files = walk(predicate);
+
+        return parallel(files.size(), threads, [&](std::size_t i, const std::atomic<bool>& stopped)
+        {
+            Access access(*this, files[i], false, false);
+
+            return access.stream().for_each([&](const Key& key)
+            {
+                return !stopped && visitor(files[i], key);
+            });
+        });
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Load a dump made by bulk_export() in the room, each
+    /// drawer written once in its final encoding
+    ///
+    /// Records are sorted in memory up to the budget, then spilled
+    /// to sorted runs in the hidden .cnroom directory. The runs of
+    /// each drawer are merged with the keys of the drawer, which
+    /// is rewritten at once, and drawers are spread over several
+    /// threads. The last record of a key in the dump wins over the
+    /// previous ones and over the key of the drawer, other keys of
+    /// the drawer are kept. New drawers take the encoding of the
+    /// room.
+    ///
+    /// \param input Stream on the dump
+    /// \param progress Function called as records are read and
+    /// once per drawer written, by one thread at a time, nullptr
+    /// by default
+    /// \param memory Memory budget of the records sorted at once,
+    /// in bytes, 64 MB by default
+    /// \param threads Number of threads, 0 by default to use one
+    /// per hardware thread
+    ///
+    ////////////////////////////////////////////////////////////
+    void    bulk_load(std::istream& input, std::function<void(const Progress&)> progress = nullptr, std::size_t memory = std::size_t(64) << 20, std::size_t threads = 0)
+    {
+        std::string header(signature().size(), '\0');
+
+        input.read(header.data(), static_cast<std::streamsize>(header.size()));
+
+        if(!input || header != signature())
+        {
+            throw std::runtime_error("Could not load, not a dump");
+        }
+
+        static std::atomic<std::uint64_t> loads(0);
+
+        std::filesystem::path directory;
+        std::shared_ptr<Journal> journal;
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            directory = mBase / ".cnroom";
+            journal = mJournal;
+        }
+
+        std::filesystem::create_directories(directory);
+
+        std::string prefix = "bulk." + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + "." + std::to_string(loads++);
+
+        std::vector<Run> runs;
+        Progress state;
+
+        try
+        {
+            std::vector<std::pair<std::string, std::string>> staged;
+            std::size_t used = 0;
+
+            std::string drawer;
+            std::string record;
+            Codec::Record parsed;
+
+            while(frame(input, drawer, record))
+            {
+                std::string name = Stream::normalize(drawer);
+
+                if(name.empty() || name == "." || name.compare(0, 2, "..") == 0 || std::filesystem::path(name).has_root_path())
+                {
+                    throw std::runtime_error("Could not load, invalid path \"" + drawer + "\" in dump");
+                }
+
+                if(!Codec::next(record, 0, Encoding::Binary, parsed) || parsed.size != record.size() || parsed.removed)
+                {
+                    throw std::runtime_error("Could not load, corrupted dump");
+                }
+
+                used += sizeof(staged[0]) + name.size() + record.size();
+
+                staged.emplace_back(std::move(name), std::move(record));
+
+                ++state.records;
+
+                if(used >= memory)
+                {
+                    runs.push_back(Run{directory / (prefix + "." + std::to_string(runs.size()) + ".run"), {}});
+
+                    spill(staged, runs.back());
+
+                    staged.clear();
+                    used = 0;
+                }
+
+                if(progress && state.records % 4096 == 0)
+                {
+                    progress(state);
+                }
+            }
+
+            if(!staged.empty())
+            {
+                runs.push_back(Run{directory / (prefix + "." + std::to_string(runs.size()) + ".run"), {}});
+
+                spill(staged, runs.back());
+            }
+
+            staged = {};
+
+            std::set<std::string> names;
+
+            for(const auto& it: runs)
+            {
+                for(const auto& section: it.sections)
+                {
+                    names.insert(section.first);
+                }
+            }
+
+            std::vector<std::string> drawers(names.begin(), names.end());
+
+            state.total = drawers.size();
+
+            if(progress)
+            {
+                progress(state);
+            }
+
+            if(journal)
+            {
+                journal->checkpoint();
+            }
+
+            std::mutex reporting;
+
+            parallel(drawers.size(), threads, [&](std::size_t i, const std::atomic<bool>&)
+            {
+                std::vector<std::unique_ptr<std::ifstream>> readers;
+                std::vector<std::uint64_t> remaining;
+                std::vector<std::string> heads;
+
+                std::string path;
+
+                auto advance = [&](std::size_t j)
+                {
+                    heads[j].clear();
+
+                    if(remaining[j] > 0)
+                    {
+                        if(!frame(*readers[j], path, heads[j]) || path != drawers[i] || 8 + path.size() + heads[j].size() - 4 > remaining[j])
+                        {
+                            throw std::runtime_error("Could not load, run failed");
+                        }
+
+                        remaining[j] -= 8 + path.size() + heads[j].size() - 4;
+                    }
+                };
+
+                for(const auto& it: runs)
+                {
+                    auto found = it.sections.find(drawers[i]);
+
+                    if(found != it.sections.end())
+                    {
+                        readers.push_back(std::make_unique<std::ifstream>(it.file, std::ios_base::in | std::ios_base::binary));
+                        readers.back()->seekg(static_cast<std::streamoff>(found->second.first), std::ios_base::beg);
+
+                        remaining.push_back(found->second.second);
+                        heads.emplace_back();
+
+                        advance(heads.size() - 1);
+                    }
+                }
+
+                Access access(*this, drawers[i], true, true);
+
+                access.stream().pour([&](std::string& record)
+                {
+                    std::size_t chosen = heads.size();
+
+                    for(std::size_t j = 0; j < heads.size(); ++j)
+                    {
+                        if(!heads[j].empty() && (chosen == heads.size() || named(heads[j]) <= named(heads[chosen])))
+                        {
+                            chosen = j;
+                        }
+                    }
+
+                    if(chosen < heads.size())
+                    {
+                        record = std::move(heads[chosen]);
+
+                        for(std::size_t j = 0; j < heads.size(); ++j)
+                        {
+                            if(j == chosen || (!heads[j].empty() && named(heads[j]) == named(record)))
+                            {
+                                advance(j);
+                            }
+                        }
+                    }
+
+                    return chosen < heads.size();
+                });
+
+                access.commit();
+
+                if(progress)
+                {
+                    std::lock_guard<std::mutex> lock(reporting);
+
+                    ++state.drawers;
+
+                    progress(state);
+                }
+
+                return true;
+            });
+        }
+        catch(...)
+        {
+            for(const auto& it: runs)
+            {
+                std::error_code ignored;
+                std::filesystem::remove(it.file, ignored);
+            }
+
+            throw;
+        }
+
+        for(const auto& it: runs)
+        {
+            std::filesystem::remove(it.file);
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Export the keys of the drawers of the room to a
+    /// dump, to load in a room with bulk_load()
+    ///
+    /// Directories of the room are walked recursively, each
+    /// drawer is read in one pass and drawers are spread over
+    /// several threads. The records of a drawer are written to
+    /// the dump in chunks, chunks of different drawers may
+    /// interleave.
+    ///
+    /// The dump starts with a header of 8 bytes, the magic
+    /// "\x89CND", a version byte and 3 reserved bytes. Each record
+    /// follows as the length of the path of the drawer on 4 bytes
+    /// in little endian, the path, and the key encoded as in a
+    /// binary drawer.
+    ///
+    /// \param output Stream to write the dump to
+    /// \param predicate Function called with the path of each
+    /// file, returns true to export its keys
+    /// \param progress Function called once per drawer read, by
+    /// one thread at a time, nullptr by default
+    /// \param threads Number of threads, 0 by default to use one
+    /// per hardware thread
+    ///
+    ////////////////////////////////////////////////////////////
+    void    bulk_export(std::ostream& output, std::function<bool(const std::filesystem::path&)> predicate, std::function<void(const Progress&)> progress = nullptr, std::size_t threads = 0)
+    {
+        const std::size_t chunk = 1 << 20;
+
+        std::vector<std::filesystem::path> files = walk(predicate);
+
+        output.write(signature().data(), static_cast<std::streamsize>(signature().size()));
+
+        Progress state;
+        state.total = files.size();
+
+        std::mutex writing;
+
+        auto write = [&](std::string& bytes, std::uint64_t records)
+        {
+            std::lock_guard<std::mutex> lock(writing);
+
+            output.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+
+            if(!output)
+            {
+                throw std::runtime_error("Could not export, stream failed");
+            }
+
+            state.records += records;
+
+            bytes.clear();
+        };
+
+        parallel(files.size(), threads, [&](std::size_t i, const std::atomic<bool>& stopped)
+        {
+            std::string drawer = Stream::normalize(files[i]);
+            std::string bytes;
+            std::uint64_t records = 0;
+
+            Access access(*this, files[i], false, false);
+
+            access.stream().for_each([&](const Key& key)
+            {
+                frame(bytes, drawer, Codec::record(key, Encoding::Binary));
+
+                ++records;
+
+                if(bytes.size() >= chunk)
+                {
+                    write(bytes, records);
+
+                    records = 0;
+                }
+
+                return !stopped.load();
+            });
+
+            write(bytes, records);
+
+            if(progress)
+            {
+                std::lock_guard<std::mutex> lock(writing);
+
+                ++state.drawers;
+
+                progress(state);
+            }
+
+            return true;
+        });
+
+        output.flush();
+
+        if(!output)
+        {
+            throw std::runtime_error("Could not export, stream failed");
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the statistics of each drawer opened since the
+    /// room connected, empty unless CNROOM_STATISTICS is defined
+    /// to 1
+    ///
+    /// Statistics outlive closing the drawer, the time waiting
+    /// for a drawer and holding it counts every operation of the
+    /// room, callbacks of open() and view() included.
+    ///
+    /// \return Statistics by path of the drawer, to export with
+    /// Statistics::prometheus()
+    ///
+    ////////////////////////////////////////////////////////////
+    std::map<std::string, Statistics> statistics()
+    {
+        std::map<std::string, Statistics> drawers;
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        for(const auto& it: mRecorders)
+        {
+            drawers.emplace(it.first, it.second->snapshot());
+        }
+
+        return drawers;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Set the statistics of every drawer back to zero
+    ///
+    ////////////////////////////////////////////////////////////
+    void    reset_statistics()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        for(const auto& it: mRecorders)
+        {
+            it.second->reset();
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Map a drawer in memory to read it without copies
+    ///
+    /// The room doesn't patch values in place while the mapped
+    /// drawer lives, as a snapshot, so it keeps the drawer as it
+    /// was when mapped.
+    ///
+    /// \param file Path to the file, must exist
+    ///
+    /// \return Mapped drawer, views the drawer as it was when
+    /// mapped
+    ///
+    ////////////////////////////////////////////////////////////
+    MappedDrawer map(const std::filesystem::path& file)
+    {
+        std::shared_ptr<const void> pin = std::make_shared<char>(0);
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            forget();
+
+            mVersions[Stream::normalize(file)].mappings.push_back(pin);
+        }
+
+        MappedDrawer drawer(mBase / file);
+        drawer.mPin = std::move(pin);
+
+        return drawer;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Take a consistent snapshot of drawers, to read
+    /// them for as long as needed without blocking writers
+    ///
+    /// The drawers are locked for reading in the order of their
+    /// paths until every one is mapped, so the snapshot sees them
+    /// at the same point in time. A drawer that didn't change
+    /// since a snapshot still held shares its version.
+    ///
+    /// \param files Paths to the files, must exist
+    ///
+    /// \return Snapshot
+    ///
+    ////////////////////////////////////////////////////////////
+    Snapshot snapshot(const std::vector<std::filesystem::path>& files)
+    {
+        std::set<std::string> names;
+
+        for(const auto& it: files)
+        {
+            names.insert(Stream::normalize(it));
+        }
+
+        std::vector<std::unique_ptr<Access>> accesses;
+
+        for(const auto& it: names)
+        {
+            accesses.push_back(std::make_unique<Access>(*this, it, false, false));
+        }
+
+        Snapshot snapshot;
+
+        std::size_t i = 0;
+
+        for(const auto& it: names)
+        {
+            Stream& stream = accesses[i++]->stream();
+
+            std::string stamp = stream.stamp();
+
+            if(stream.mBlobs)
+            {
+                snapshot.mBlobs.emplace(it, stream.mBlobs);
+            }
+
+            std::shared_ptr<const MappedDrawer> drawer;
+
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+
+                auto found = mVersions.find(it);
+
+                if(found != mVersions.end() && found->second.stamp == stamp && !found->second.drawers.empty())
+                {
+                    drawer = found->second.drawers.back().lock();
+                }
+            }
+
+            if(!drawer)
+            {
+                drawer = std::make_shared<const MappedDrawer>(mBase / it);
+
+                std::lock_guard<std::mutex> lock(mMutex);
+
+                forget();
+
+                Versions& versions = mVersions[it];
+
+                versions.drawers.erase(std::remove_if(versions.drawers.begin(), versions.drawers.end(), [](const auto& version){ return version.expired(); }), versions.drawers.end());
+                versions.drawers.push_back(drawer);
+                versions.stamp = stamp;
+            }
+
+            snapshot.mDrawers.emplace(it, std::move(drawer));
+        }
+
+        return snapshot;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Check if file exists
+    ///
+    /// \param file Path to the file
+    ///
+    /// \return True if file exists
+    ///
+    ////////////////////////////////////////////////////////////
+    bool    exists(const std::filesystem::path& file)
+    {
+        if(std::filesystem::exists(mBase / file))
+        {
+            return true;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Destroy a file or directory
+    ///
+    /// \param file Path to the file
+    ///
+    ////////////////////////////////////////////////////////////
+    void    destroy(const std::filesystem::path& file)
+    {
+        if(std::filesystem::exists(mBase / file))
+        {
+            evict(file);
+
+            std::shared_ptr<Journal> journal;
+
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+
+                journal = mJournal;
+            }
+
+            if(journal)
+            {
+                journal->checkpoint();
+            }
+
+            if(std::filesystem::is_regular_file(mBase / file))
+            {
+                std::filesystem::remove(Stream::sidecar(mBase / file, ".idx"));
+                std::filesystem::remove(Stream::sidecar(mBase / file, ".sdx"));
+                std::filesystem::remove(Stream::sidecar(mBase / file, ".blb"));
+            }
+
+            std::filesystem::remove_all(mBase / file);
+        }
+        else
+        {
+            throw std::runtime_error("Path \"" + file.string() + "\" doesn't point to any file");
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Short way to write a key in a drawer
+    ///
+    /// \param file Path to the file
+    /// \param key Key to write
+    /// \param create Create a new file if path doesn't point to
+    /// any, false by default
+    ///
+    ////////////////////////////////////////////////////////////
+    void    quick_write(const std::filesystem::path& file, const Key& key, bool create = false)
+    {
+        Access access(*this, file, create, true);
+
+        access.stream() << key;
+
+        access.commit();
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Short way to apply a batch of writes and removals
+    /// to a drawer at once
+    ///
+    /// \param file Path to the file
+    /// \param batch Operations to apply
+    /// \param create Create a new file if path doesn't point to
+    /// any, false by default
+    ///
+    ////////////////////////////////////////////////////////////
+    void    quick_apply(const std::filesystem::path& file, const WriteBatch& batch, bool create = false)
+    {
+        Access access(*this, file, create, true);
+
+        access.stream().apply(batch);
+
+        access.commit();
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Short way to read a key from a drawer, served by the
+    /// cache of the room if enabled and not locking between
+    /// processes
+    ///
+    /// \param file Path to the file, must exist
+    /// \param name Name of the key
+    ///
+    ////////////////////////////////////////////////////////////
+    Key     quick_read(const std::filesystem::path& file, const std::string& name)
+    {
+        Key key;
+
+        if(mCache.capacity() == 0)
+        {
+            Access access(*this, file, false, false);
+
+            key = access.stream().read(name);
+        }
+        else
+        {
+            std::string drawer = Stream::normalize(file);
+
+            if(!mCache.find(drawer, name, key))
+            {
+                Access access(*this, file, false, false);
+
+                Cache::Version version = mCache.version(drawer);
+
+                key = access.stream().read(name);
+
+                mCache.insert(drawer, key, version);
+            }
+        }
+
+        return key;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Short way to read several keys from a drawer in one
+    /// pass, served by the cache of the room if enabled and not
+    /// locking between processes
+    ///
+    /// \param file Path to the file, must exist
+    /// \param names Names of the keys
+    ///
+    /// \return Keys in the order of the names
+    ///
+    ////////////////////////////////////////////////////////////
+    std::vector<Key> quick_read_many(const std::filesystem::path& file, const std::vector<std::string>& names)
+    {
+        std::vector<Key> keys;
+
+        if(mCache.capacity() == 0)
+        {
+            Access access(*this, file, false, false);
+
+            keys = access.stream().read_many(names);
+        }
+        else
+        {
+            std::string drawer = Stream::normalize(file);
+
+            keys.resize(names.size());
+
+            std::vector<std::string> missing;
+            std::vector<std::size_t> positions;
+
+            for(std::size_t i = 0; i < names.size(); ++i)
+            {
+                if(!mCache.find(drawer, names[i], keys[i]))
+                {
+                    missing.push_back(names[i]);
+                    positions.push_back(i);
+                }
+            }
+
+            if(!missing.empty())
+            {
+                Access access(*this, file, false, false);
+
+                Cache::Version version = mCache.version(drawer);
+
+                std::vector<Key> read = access.stream().read_many(missing);
+
+                for(std::size_t i = 0; i < read.size(); ++i)
+                {
+                    mCache.insert(drawer, read[i], version);
+
+                    keys[positions[i]] = std::move(read[i]);
+                }
+            }
+        }
+
+        return keys;
+    }
+
+protected:
+
+private:
+    friend class ShardedDrawer;
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Open drawer, shared by the operations using it
+    ///
+    ////////////////////////////////////////////////////////////
+    struct Drawer
+    {
+        std::string                 name;       ///< Normalized path to the file
+        std::shared_mutex           lock;       ///< Lock between threads, exclusive for writing
+        std::mutex                  guard;      ///< Guards the number of readers
+        std::size_t                 readers = 0;///< Number of threads reading the drawer
+        std::once_flag              opened;     ///< Opens the stream once
+        std::unique_ptr<FileLock>   process;    ///< Lock between processes, if enabled
+        std::uint64_t               generation = FileLock::unknown; ///< Modifications of the drawer known by the stream
+        std::unique_ptr<Stream>     stream;     ///< Stream on the file
+        std::atomic<bool>           stale{false}; ///< True once evicted while in use, reloaded by the next operation and closed once released
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Open drawer in the pool
+    ///
+    ////////////////////////////////////////////////////////////
+    struct Handle
+    {
+        std::string             name;   ///< Normalized path to the file
+        std::shared_ptr<Drawer> drawer; ///< Drawer
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Request queued on the executor
+    ///
+    ////////////////////////////////////////////////////////////
+    struct Request
+    {
+        ////////////////////////////////////////////////////////////
+        /// \brief Kinds of requests
+        ///
+        ////////////////////////////////////////////////////////////
+        enum class Kind
+        {
+            Read,   ///< Read a key
+            Write,  ///< Write a key
+            Open    ///< Call a function on the stream
+        };
+
+        Kind                            kind = Kind::Read;  ///< Kind of request
+        std::string                     name;               ///< Name of the key to read
+        Key                             key;                ///< Key to write, or key read
+        std::function<void(Stream&)>    function;           ///< Function to call
+        bool                            create = false;     ///< Create the file if it doesn't exist
+        std::exception_ptr              error;              ///< Exception of the request, if any
+        std::function<void(Key&&, std::exception_ptr)> done; ///< Called once served, the drawer unlocked
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Requests queued for a drawer
+    ///
+    ////////////////////////////////////////////////////////////
+    struct Queue
+    {
+        std::vector<Request>    requests;           ///< Requests in the order they were made
+        bool                    scheduled = false;  ///< True while the drawer is ready or served
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Locks a drawer of the room for the duration of an
+    /// operation
+    ///
+    ////////////////////////////////////////////////////////////
+    class Access
+    {
+    public:
+        ////////////////////////////////////////////////////////////
+        /// \brief Acquire and lock a drawer
+        ///
+        /// \param room Room of the drawer
+        /// \param file Path to the file
+        /// \param create Create a new file if path doesn't point to
+        /// any
+        /// \param exclusive True to modify the drawer, false to
+        /// share it with other readers
+        ///
+        ////////////////////////////////////////////////////////////
+                Access(Room& room, const std::filesystem::path& file, bool create, bool exclusive) : mRoom(room), mDrawer(room.acquire(file, create)), mExclusive(exclusive)
+        {
+            try
+            {
+                Recorder::Stopwatch stopwatch(mDrawer->stream->mRecorder.get(), Statistics::Timer::Wait);
+
+                lock();
+            }
+            catch(...)
+            {
+                release();
+                throw;
+            }
+
+            if constexpr(statistics_enabled)
+            {
+                mLocked = std::chrono::steady_clock::now();
+            }
+        }
+
+                Access(const Access&) = delete;
+        Access& operator =(const Access&) = delete;
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Unlock and release the drawer
+        ///
+        ////////////////////////////////////////////////////////////
+                ~Access()
+        {
+            if constexpr(statistics_enabled)
+            {
+                mDrawer->stream->mRecorder->time(Statistics::Timer::Hold, std::chrono::steady_clock::now() - mLocked);
+            }
+
+            unlock();
+            release();
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Get the stream of the drawer
+        ///
+        /// \return Stream
+        ///
+        ////////////////////////////////////////////////////////////
+        Stream& stream()
+        {
+            return *mDrawer->stream;
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Make the modifications durable as the room
+        /// requires, and empty the journal if it grew large
+        ///
+        ////////////////////////////////////////////////////////////
+        void    commit()
+        {
+            const std::shared_ptr<Journal>& journal = mDrawer->stream->mJournal;
+
+            if(journal)
+            {
+                if(journal->durability() == Durability::Batch)
+                {
+                    journal->sync();
+                }
+
+                journal->collect();
+            }
+        }
+
+    private:
+        ////////////////////////////////////////////////////////////
+        /// \brief Lock the drawer between threads, then between
+        /// processes, reload the stream if another process modified
+        /// the drawer
+        ///
+        ////////////////////////////////////////////////////////////
+        void    lock()
+        {
+            if(mExclusive)
+            {
+                mDrawer->lock.lock();
+
+                try
+                {
+                    refresh();
+
+                    if(mDrawer->process)
+                    {
+                        sync(mDrawer->process->lock(true));
+                    }
+                }
+                catch(...)
+                {
+                    mDrawer->lock.unlock();
+                    throw;
+                }
+            }
+            else
+            {
+                if(mDrawer->stale)
+                {
+                    std::unique_lock<std::shared_mutex> reloading(mDrawer->lock);
+
+                    refresh();
+                }
+
+                mDrawer->lock.lock_shared();
+
+                try
+                {
+                    std::lock_guard<std::mutex> guard(mDrawer->guard);
+
+                    if(mDrawer->process && mDrawer->readers == 0)
+                    {
+                        sync(mDrawer->process->lock(false));
+                    }
+
+                    ++mDrawer->readers;
+                }
+                catch(...)
+                {
+                    mDrawer->lock.unlock_shared();
+                    throw;
+                }
+            }
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Unlock the drawer in the reverse order
+        ///
+        ////////////////////////////////////////////////////////////
+        void    unlock()
+        {
+            if(mExclusive)
+            {
+                if(mRoom.mCache.capacity() > 0)
+                {
+                    mRoom.mCache.invalidate(mDrawer->name);
+                }
+
+                if(mDrawer->process)
+                {
+                    mDrawer->generation = mDrawer->process->unlock(true);
+                }
+
+                mDrawer->lock.unlock();
+            }
+            else
+            {
+                {
+                    std::lock_guard<std::mutex> guard(mDrawer->guard);
+
+                    if(--mDrawer->readers == 0 && mDrawer->process)
+                    {
+                        mDrawer->process->unlock(false);
+                    }
+                }
+
+                mDrawer->lock.unlock_shared();
+            }
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Reload the stream of a drawer evicted while in
+        /// use, the drawer must be locked for writing
+        ///
+        ////////////////////////////////////////////////////////////
+        void    refresh()
+        {
+            if(mDrawer->stale.exchange(false))
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mRoom.mMutex);
+
+                    --mRoom.mStale;
+                }
+
+                try
+                {
+                    mDrawer->stream->reload();
+                }
+                catch(...)
+                {
+                    std::lock_guard<std::mutex> lock(mRoom.mMutex);
+
+                    if(!mDrawer->stale.exchange(true))
+                    {
+                        ++mRoom.mStale;
+                    }
+
+                    throw;
+                }
+            }
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Reload the stream if the drawer changed since it
+        /// was last read
+        ///
+        /// \param generation Modifications of the drawer
+        ///
+        ////////////////////////////////////////////////////////////
+        void    sync(std::uint64_t generation)
+        {
+            if(generation != mDrawer->generation)
+            {
+                try
+                {
+                    mDrawer->stream->reload();
+                }
+                catch(...)
+                {
+                    mDrawer->process->unlock(false);
+                    throw;
+                }
+
+                mDrawer->generation = generation;
+            }
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Release the drawer and close the least recently
+        /// used drawers above the size of the pool
+        ///
+        ////////////////////////////////////////////////////////////
+        void    release()
+        {
+            mDrawer.reset();
+
+            std::lock_guard<std::mutex> lock(mRoom.mMutex);
+
+            mRoom.trim();
+        }
+
+        ////////////////////////////////////////////////////////////
+        // Member data
+        ////////////////////////////////////////////////////////////
+        Room&                   mRoom;      ///< Room of the drawer
+        std::shared_ptr<Drawer> mDrawer;    ///< Drawer
+        bool                    mExclusive; ///< True if locked for writing
+        std::chrono::steady_clock::time_point mLocked; ///< Time the drawer was locked
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get a drawer, opening it if it isn't open yet
+    ///
+    /// The pool is only locked to find the drawer, the stream is
+    /// opened once by the first operation using the drawer. While
+    /// locking between processes, the file is created, opened and
+    /// converted under the lock of the drawer.
+    ///
+    /// \param file Path to the file
+    /// \param create Create a new file if path doesn't point to
+    /// any
+    ///
+    /// \return Drawer, the most recently used
+    ///
+    ////////////////////////////////////////////////////////////
+    std::shared_ptr<Drawer> acquire(const std::filesystem::path& file, bool create)
+    {
+        std::string name = Stream::normalize(file);
+
+        std::shared_ptr<Drawer> drawer;
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            auto found = mHandles.find(name);
+
+            if(found != mHandles.end())
+            {
+                mRecent.splice(mRecent.begin(), mRecent, found->second);
+            }
+            else
+            {
+                mRecent.push_front({name, std::make_shared<Drawer>()});
+                mRecent.front().drawer->name = name;
+
+                found = mHandles.emplace(name, mRecent.begin()).first;
+            }
+
+            drawer = found->second->drawer;
+        }
+
+        try
+        {
+            std::call_once(drawer->opened, [&]()
+            {
+                std::unique_lock<std::shared_mutex> opening(drawer->lock);
+                std::unique_lock<std::mutex> settings(mMutex);
+
+                std::filesystem::path path = mBase / file;
+                Stream::Mode mode = mMode;
+                double threshold = mThreshold;
+                std::size_t outline = mOutline;
+                Encoding encoding = mEncoding;
+                bool process = mProcess;
+                std::shared_ptr<Journal> journal = mJournal;
+                std::shared_ptr<Recorder> recorder;
+
+                if constexpr(statistics_enabled)
+                {
+                    std::shared_ptr<Recorder>& found = mRecorders[name];
+
+                    if(!found)
+                    {
+                        found = std::make_shared<Recorder>();
+                    }
+
+                    recorder = found;
+                }
+
+                settings.unlock();
+
+                if(std::filesystem::exists(path))
+                {
+                    if(!std::filesystem::is_regular_file(path))
+                    {
+                        throw std::runtime_error("Invalid path \"" + file.string() + "\", must be a regular file");
+                    }
+                }
+                else if(!create)
+                {
+                    throw std::runtime_error("Path \"" + file.string() + "\" doesn't point to any file");
+                }
+
+                std::unique_ptr<FileLock> locking;
+
+                if(process)
+                {
+                    locking = std::make_unique<FileLock>(Stream::sidecar(path, ".lock"));
+                    locking->lock(true);
+                }
+
+                auto stream = std::make_unique<Stream>();
+                bool converted = false;
+
+                try
+                {
+                    stream->mRecorder = recorder;
+                    stream->set_mode(mode);
+                    stream->set_compaction_threshold(threshold);
+                    stream->set_blob_threshold(outline);
+                    stream->mPinned = [this, name](){ return pinned(name); };
+                    stream->open(path, create);
+
+                    if(encoding != Encoding::Text && stream->encoding() != encoding && stream->size() == 0)
+                    {
+                        stream->convert(encoding);
+                        converted = true;
+                    }
+                }
+                catch(...)
+                {
+                    if(locking)
+                    {
+                        locking->unlock(false);
+                    }
+
+                    throw;
+                }
+
+                if(locking)
+                {
+                    drawer->generation = locking->unlock(converted);
+                    drawer->process = std::move(locking);
+                }
+
+                stream->mJournal = journal;
+
+                drawer->stream = std::move(stream);
+            });
+        }
+        catch(...)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            auto found = mHandles.find(name);
+
+            if(found != mHandles.end() && found->second->drawer == drawer)
+            {
+                close(found->second);
+            }
+
+            throw;
+        }
+
+        return drawer;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Queue a request fulfilling a promise
+    ///
+    /// \param file Path to the file
+    /// \param request Request
+    /// \param promise Promise to fulfill
+    ///
+    /// \return Future of the promise
+    ///
+    ////////////////////////////////////////////////////////////
+    std::future<void> submit(const std::filesystem::path& file, Request request, std::shared_ptr<std::promise<void>> promise)
+    {
+        request.done = [promise](Key&&, std::exception_ptr error)
+        {
+            if(error)
+            {
+                promise->set_exception(error);
+            }
+            else
+            {
+                promise->set_value();
+            }
+        };
+
+        std::future<void> future = promise->get_future();
+
+        submit(file, std::move(request));
+
+        return future;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Queue a request for its drawer, and start the
+    /// executor on the first request
+    ///
+    /// \param file Path to the file
+    /// \param request Request
+    ///
+    ////////////////////////////////////////////////////////////
+    void    submit(const std::filesystem::path& file, Request request)
+    {
+        std::string name = Stream::normalize(file);
+
+        std::lock_guard<std::mutex> lock(mExecuting);
+
+        if(mWorkers.empty())
+        {
+            std::size_t threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+            for(std::size_t i = 0; i < threads; ++i)
+            {
+                mWorkers.emplace_back([this](){ work(); });
+            }
+        }
+
+        Queue& queue = mQueues[name];
+
+        queue.requests.push_back(std::move(request));
+
+        if(!queue.scheduled)
+        {
+            queue.scheduled = true;
+
+            mReady.push_back(name);
+            mWaking.notify_one();
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Serve the drawers with queued requests until the
+    /// room is destroyed, a drawer is served by one thread at a
+    /// time
+    ///
+    ////////////////////////////////////////////////////////////
+    void    work()
+    {
+        std::unique_lock<std::mutex> lock(mExecuting);
+
+        bool done = false;
+
+        while(!done)
+        {
+            mWaking.wait(lock, [this](){ return !mReady.empty() || mStopping; });
+
+            if(mReady.empty())
+            {
+                done = true;
+            }
+            else
+            {
+                std::string name = std::move(mReady.front());
+                mReady.pop_front();
+
+                std::vector<Request> requests;
+                requests.swap(mQueues[name].requests);
+
+                lock.unlock();
+
+                std::size_t served = serve(name, requests);
+
+                lock.lock();
+
+                Queue& queue = mQueues[name];
+
+                queue.requests.insert(queue.requests.begin(), std::make_move_iterator(requests.begin() + static_cast<std::ptrdiff_t>(served)), std::make_move_iterator(requests.end()));
+
+                if(queue.requests.empty())
+                {
+                    mQueues.erase(name);
+                }
+                else
+                {
+                    mReady.push_back(name);
+                }
+            }
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Serve the requests of a drawer in one pass, then
+    /// complete them once the drawer is unlocked
+    ///
+    /// Consecutive writes are applied as one batch, reads see the
+    /// writes queued before them. A function that throws ends the
+    /// pass, the following requests are served by another pass on
+    /// the reopened drawer.
+    ///
+    /// \param name Normalized path to the file
+    /// \param requests Requests in the order they were made
+    ///
+    /// \return Number of requests served
+    ///
+    ////////////////////////////////////////////////////////////
+    std::size_t serve(const std::string& name, std::vector<Request>& requests)
+    {
+        bool create = false;
+        bool exclusive = false;
+
+        for(const auto& it: requests)
+        {
+            create = create || it.create;
+            exclusive = exclusive || it.kind != Request::Kind::Read;
+        }
+
+        std::size_t served = requests.size();
+        bool locked = false;
+
+        try
+        {
+            Access access(*this, name, create, exclusive);
+
+            locked = true;
+
+            Stream& stream = access.stream();
+
+            WriteBatch batch;
+            std::vector<Request*> batched;
+
+            auto flush = [&stream, &batch, &batched]()
+            {
+                if(!batch.empty())
+                {
+                    try
+                    {
+                        stream.apply(batch);
+                    }
+                    catch(...)
+                    {
+                        for(auto& it: batched)
+                        {
+                            it->error = std::current_exception();
+                        }
+                    }
+
+                    batch.clear();
+                    batched.clear();
+                }
+            };
+
+            for(std::size_t i = 0; i < served; ++i)
+            {
+                Request& it = requests[i];
+
+                try
+                {
+                    if(it.kind == Request::Kind::Write)
+                    {
+                        batch.write(it.key);
+                        batched.push_back(&it);
+                    }
+                    else if(it.kind == Request::Kind::Read)
+                    {
+                        const WriteBatch::Operation* pending = batch.find(it.name);
+
+                        if(pending)
+                        {
+                            it.key = pending->second ? *pending->second : Key{it.name, {}};
+                        }
+                        else
+                        {
+                            it.key = stream.read(it.name);
+                        }
+                    }
+                    else
+                    {
+                        flush();
+
+                        it.function(stream);
+
+                        stream.rollback();
+                    }
+                }
+                catch(...)
+                {
+                    it.error = std::current_exception();
+
+                    if(it.kind == Request::Kind::Open)
+                    {
+                        evict(name);
+
+                        served = i + 1;
+                    }
+                }
+            }
+
+            flush();
+
+            access.commit();
+        }
+        catch(...)
+        {
+            for(std::size_t i = 0; i < served; ++i)
+            {
+                if(!requests[i].error && (!locked || requests[i].kind != Request::Kind::Read))
+                {
+                    requests[i].error = std::current_exception();
+                }
+            }
+        }
+
+        for(std::size_t i = 0; i < served; ++i)
+        {
+            requests[i].done(std::move(requests[i].key), requests[i].error);
+        }
+
+        return served;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Check if a snapshot or a drawer mapped by map()
+    /// still holds a version of a drawer
+    ///
+    /// \param name Normalized path to the file
+    ///
+    /// \return True if a version is held
+    ///
+    ////////////////////////////////////////////////////////////
+    bool    pinned(const std::string& name)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        bool held = false;
+
+        auto found = mVersions.find(name);
+
+        if(found != mVersions.end())
+        {
+            held = std::any_of(found->second.drawers.begin(), found->second.drawers.end(), [](const auto& version){ return !version.expired(); }) ||
+                   std::any_of(found->second.mappings.begin(), found->second.mappings.end(), [](const auto& pin){ return !pin.expired(); });
+
+            if(!held)
+            {
+                mVersions.erase(found);
+            }
+        }
+
+        return held;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Forget the drawers whose versions and mappings were
+    /// all released, the mutex of the room must be held
+    ///
+    ////////////////////////////////////////////////////////////
+    void    forget()
+    {
+        auto it = mVersions.begin();
+
+        while(it != mVersions.end())
+        {
+            auto& mappings = it->second.mappings;
+
+            mappings.erase(std::remove_if(mappings.begin(), mappings.end(), [](const auto& pin){ return pin.expired(); }), mappings.end());
+
+            const auto& drawers = it->second.drawers;
+
+            if(mappings.empty() && std::all_of(drawers.begin(), drawers.end(), [](const auto& version){ return version.expired(); }))
+            {
+                it = mVersions.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Replay the journals left in the base directory,
+    /// each drawer is rewritten once and synced
+    ///
+    ////////////////////////////////////////////////////////////
+    void    recover()
+    {
+        Journal::recover(mBase, [this](const Journal::Entries& entries)
+        {
+            std::map<std::string, WriteBatch> batches;
+
+            for(const auto& it: entries)
+            {
+                WriteBatch& batch = batches[it.first];
+
+                std::size_t position = 0;
+
+                Codec::Record record;
+                while(Codec::next(it.second, position, Encoding::Binary, record))
+                {
+                    if(record.removed)
+                    {
+                        batch.remove(std::string(record.name));
+                    }
+                    else
+                    {
+                        Key key{std::string(record.name), {}};
+                        Codec::parse(record.values, Encoding::Binary, key);
+
+                        batch.write(key);
+                    }
+
+                    position += record.size;
+                }
+            }
+
+            for(const auto& it: batches)
+            {
+                std::filesystem::path path = mBase / it.first;
+
+                Stream stream(path, true);
+
+                if(mEncoding != Encoding::Text && stream.encoding() != mEncoding && stream.size() == 0)
+                {
+                    stream.convert(mEncoding);
+                }
+
+                stream.apply(it.second);
+
+                Journal::persist(path);
+                Journal::persist(path.parent_path());
+            }
+        });
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Update a setting of the room and get the open
+    /// drawers to update
+    ///
+    /// \param update Function updating the setting
+    ///
+    /// \return Open drawers
+    ///
+    ////////////////////////////////////////////////////////////
+    std::vector<std::shared_ptr<Drawer>> drawers(const std::function<void()>& update)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        update();
+
+        std::vector<std::shared_ptr<Drawer>> drawers;
+
+        for(const auto& it: mRecent)
+        {
+            drawers.push_back(it.drawer);
+        }
+
+        return drawers;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Close the least recently used drawers above the
+    /// size of the pool and the evicted ones, drawers in use stay
+    /// open
+    ///
+    ////////////////////////////////////////////////////////////
+    void    trim()
+    {
+        auto it = mRecent.end();
+
+        while((mRecent.size() > mCapacity || mStale > 0) && it != mRecent.begin())
+        {
+            --it;
+
+            if(it->drawer.use_count() == 1 && (mRecent.size() > mCapacity || it->drawer->stale))
+            {
+                it = close(it);
+            }
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Remove a drawer from the pool, the pool must be
+    /// locked
+    ///
+    /// \param handle Drawer in the pool
+    ///
+    /// \return Next drawer in the pool
+    ///
+    ////////////////////////////////////////////////////////////
+    std::list<Handle>::iterator close(std::list<Handle>::iterator handle)
+    {
+        if(handle->drawer->stale)
+        {
+            --mStale;
+        }
+
+        mHandles.erase(handle->name);
+
+        return mRecent.erase(handle);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Versions of a drawer mapped by snapshots
+    ///
+    ////////////////////////////////////////////////////////////
+    struct Versions
+    {
+        std::string                                     stamp;      ///< Identity of the file of the last version
+        std::vector<std::weak_ptr<const MappedDrawer>>  drawers;    ///< Versions, the last one at the back, while snapshots hold them
+        std::vector<std::weak_ptr<const void>>          mappings;   ///< Pins of the drawers mapped by map(), while they live
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Sorted run of a bulk load
+    ///
+    ////////////////////////////////////////////////////////////
+    struct Run
+    {
+        std::filesystem::path   file;       ///< Path to the run
+        std::map<std::string, std::pair<std::uint64_t, std::uint64_t>> sections; ///< Offset and size of the records of each drawer
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Run jobs over several threads, each thread taking
+    /// the next job until all are done or one stops
+    ///
+    /// The first exception thrown by a job stops the others and
+    /// is rethrown once every thread joined.
+    ///
+    /// \param count Number of jobs
+    /// \param threads Number of threads, 0 to use one per hardware
+    /// thread
+    /// \param job Function called with the number of the job and
+    /// the flag raised when the jobs stop, returns false to stop
+    ///
+    /// \return True if every job ran to the end
+    ///
+    ////////////////////////////////////////////////////////////
+    bool    parallel(std::size_t count, std::size_t threads, const std::function<bool(std::size_t, const std::atomic<bool>&)>& job)
+    {
+        if(threads == 0)
+        {
+            threads = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+
+        threads = std::min(threads, count);
+
+        std::atomic<std::size_t> next(0);
+        std::atomic<bool> stopped(false);
+        std::exception_ptr error;
+        std::mutex failing;
+
+        auto work = [&]()
+        {
+            std::size_t i;
+
+            while(!stopped && (i = next++) < count)
+            {
+                try
+                {
+                    if(!job(i, stopped))
+                    {
+                        stopped = true;
+                    }
+                }
+                catch(...)
+                {
+                    std::lock_guard<std::mutex> lock(failing);
+
+                    if(!error)
+                    {
+                        error = std::current_exception();
+                    }
+
+                    stopped = true;
+                }
+            }
+        };
+
+        std::vector<std::thread> workers;
+
+        for(std::size_t i = 1; i < threads; ++i)
+        {
+            workers.emplace_back(work);
+        }
+
+        work();
+
+        for(auto& it: workers)
+        {
+            it.join();
+        }
+
+        if(error)
+        {
+            std::rethrow_exception(error);
+        }
+
+        return !stopped;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the paths of the files of the room, directories
+    /// walked recursively
+    ///
+    /// \param predicate Function called with the path of each
+    /// file, returns true to keep it
+    ///
+    /// \return Paths relative to the base directory
+    ///
+    ////////////////////////////////////////////////////////////
+    std::vector<std::filesystem::path> walk(const std::function<bool(const std::filesystem::path&)>& predicate)
+    {
+        std::filesystem::path base;
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            base = mBase;
+        }
+
+        std::vector<std::filesystem::path> files;
+
+        for(auto it = std::filesystem::recursive_directory_iterator(base); it != std::filesystem::recursive_directory_iterator(); ++it)
+        {
+            if(it->is_directory() && it->path().filename() == ".cnroom")
+            {
+                it.disable_recursion_pending();
+            }
+            else if(it->is_regular_file())
+            {
+                std::filesystem::path file = it->path().lexically_relative(base);
+
+                if(predicate(file))
+                {
+                    files.push_back(file);
+                }
+            }
+        }
+
+        return files;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Sort the records of a bulk load by drawer and name,
+    /// keep the last record of each key and write them to a run
+    ///
+    /// \param staged Path of the drawer and binary record, in the
+    /// order of the dump
+    /// \param run Run to write, its sections filled
+    ///
+    ////////////////////////////////////////////////////////////
+    static void spill(std::vector<std::pair<std::string, std::string>>& staged, Run& run)
+    {
+        const std::size_t chunk = 1 << 20;
+
+        std::stable_sort(staged.begin(), staged.end(), [](const auto& a, const auto& b)
+        {
+            return a.first < b.first || (a.first == b.first && named(a.second) < named(b.second));
+        });
+
+        std::ofstream writer(run.file, std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+
+        std::string bytes;
+        std::uint64_t written = 0;
+
+        for(std::size_t i = 0; i < staged.size(); ++i)
+        {
+            const auto& it = staged[i];
+
+            bool last = i + 1 == staged.size() || staged[i + 1].first != it.first || named(staged[i + 1].second) != named(it.second);
+
+            if(last)
+            {
+                std::uint64_t offset = written + bytes.size();
+
+                frame(bytes, it.first, it.second);
+
+                auto& section = run.sections.emplace(it.first, std::make_pair(offset, std::uint64_t(0))).first->second;
+                section.second = written + bytes.size() - section.first;
+
+                if(bytes.size() >= chunk)
+                {
+                    writer.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+
+                    written += bytes.size();
+                    bytes.clear();
+                }
+            }
+        }
+
+        writer.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        writer.close();
+
+        if(!writer)
+        {
+            throw std::runtime_error("Could not load, failed to write run on \"" + run.file.string() + "\"");
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the header of a dump
+    ///
+    /// \return Header
+    ///
+    ////////////////////////////////////////////////////////////
+    static const std::string& signature()
+    {
+        static const std::string header = std::string("\x89" "CND", 4) + static_cast<char>(Codec::version) + std::string(3, '\0');
+
+        return header;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Append a record of a dump
+    ///
+    /// \param bytes Bytes to append to
+    /// \param drawer Normalized path to the drawer
+    /// \param record Binary record
+    ///
+    ////////////////////////////////////////////////////////////
+    static void frame(std::string& bytes, const std::string& drawer, const std::string& record)
+    {
+        Codec::put<std::uint32_t>(bytes, static_cast<std::uint32_t>(drawer.size()));
+
+        bytes += drawer;
+        bytes += record;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Read the next record of a dump
+    ///
+    /// \param input Stream on the dump
+    /// \param drawer String to fill with the path to the drawer
+    /// \param record String to fill with the binary record
+    ///
+    /// \return False at the end of the dump
+    ///
+    ////////////////////////////////////////////////////////////
+    static bool frame(std::istream& input, std::string& drawer, std::string& record)
+    {
+        char length[4];
+
+        input.read(length, sizeof(length));
+
+        bool found = input.gcount() > 0;
+
+        if(found)
+        {
+            std::string_view cursor(length, static_cast<std::size_t>(input.gcount()));
+
+            if(cursor.size() < sizeof(length))
+            {
+                throw std::runtime_error("Could not load, truncated dump");
+            }
+
+            drawer.resize(Codec::get<std::uint32_t>(cursor));
+            input.read(drawer.data(), static_cast<std::streamsize>(drawer.size()));
+
+            input.read(length, sizeof(length));
+
+            cursor = std::string_view(length, sizeof(length));
+
+            record.assign(length, sizeof(length));
+            record.resize(sizeof(length) + Codec::get<std::uint32_t>(cursor));
+
+            input.read(record.data() + sizeof(length), static_cast<std::streamsize>(record.size() - sizeof(length)));
+
+            if(!input)
+            {
+                throw std::runtime_error("Could not load, truncated dump");
+            }
+        }
+
+        return found;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the name of the key of a binary record
+    ///
+    /// \param record Binary record, complete
+    ///
+    /// \return Name of the key
+    ///
+    ////////////////////////////////////////////////////////////
+    static std::string_view named(std::string_view record)
+    {
+        std::string_view cursor = record.substr(5);
+
+        std::size_t length = Codec::get<std::uint32_t>(cursor);
+
+        return cursor.substr(0, length);
+    }
+
+    ////////////////////////////////////////////////////////////
+    // Member data
+    ////////////////////////////////////////////////////////////
+    std::filesystem::path   mBase;      ///< Path to the base directory
+    Stream::Mode            mMode;      ///< Way drawers store modifications
+    double                  mThreshold; ///< Ratio of dead records that triggers a compaction
+    std::size_t             mOutline;   ///< Size above which strings are stored as blobs
+    Encoding                mEncoding;  ///< Encoding of new drawers
+    std::size_t             mCapacity;  ///< Maximum number of open drawers
+    bool                    mProcess;   ///< True to lock drawers between processes
+    Durability              mDurability;///< Durability of the modifications
+    std::shared_ptr<Journal> mJournal;  ///< Journal of the modifications, if any
+    std::mutex              mMutex;     ///< Guards the pool and the settings
+    std::list<Handle>       mRecent;    ///< Open drawers, most recently used first
+    std::unordered_map<std::string, std::list<Handle>::iterator> mHandles; ///< Open drawers by name
+    std::size_t             mStale;     ///< Number of drawers evicted while in use, still in the pool
+    std::unordered_map<std::string, std::shared_ptr<Recorder>> mRecorders; ///< Statistics of each drawer opened
+    std::size_t             mCacheSize; ///< Memory budget of the cache, in bytes
+    Cache                   mCache;     ///< Keys read by quick_read()
+    std::unordered_map<std::string, Versions> mVersions; ///< Versions of the drawers held by snapshots
+    std::mutex              mExecuting; ///< Guards the queues of the executor
+    std::condition_variable mWaking;    ///< Signals a drawer ready or the room stopping
+    std::unordered_map<std::string, Queue> mQueues; ///< Requests queued by drawer
+    std::deque<std::string> mReady;     ///< Drawers with requests waiting for a thread
+    std::vector<std::thread> mWorkers;  ///< Threads of the executor
+    bool                    mStopping;  ///< True once the room is destroyed
+};
+
+////////////////////////////////////////////////////////////
+/// \brief Logical drawer of a room spread over several files,
+/// chosen by a hash of the name of each key
+///
+/// Shards are drawers of a directory of the room, named by the
+/// low bits of the hash they hold. A shard above the size
+/// threshold splits in two online, on one more bit of the hash,
+/// so each operation reads and rewrites a bounded file. The list
+/// of shards is kept in a manifest beside the directory, in its
+/// hidden .cnroom directory, and replaced atomically.
+///
+/// A logical drawer is used through one ShardedDrawer at a time
+/// within a process.
+///
+////////////////////////////////////////////////////////////
+class ShardedDrawer
+{
+public:
+    ////////////////////////////////////////////////////////////
+    static constexpr unsigned deepest = 20; ///< Maximum number of bits of the hash splitting shards
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Open a sharded drawer, creating it with one shard
+    /// if its directory doesn't exist
+    ///
+    /// \param room Room of the drawer, must outlive the sharded
+    /// drawer
+    /// \param file Path to the directory of the shards
+    /// \param threshold Size of a shard file above which it
+    /// splits, in bytes, 4 MB by default
+    ///
+    ////////////////////////////////////////////////////////////
+                ShardedDrawer(Room& room, const std::filesystem::path& file, std::uint64_t threshold = std::uint64_t(4) << 20) : mRoom(room), mFile(file), mThreshold(threshold)
+    {
+        std::filesystem::path manifest = Stream::sidecar(directory(), ".shards");
+
+        if(std::filesystem::exists(manifest))
+        {
+            std::ifstream reader(manifest, std::ios_base::in | std::ios_base::binary);
+
+            Shard shard;
+
+            while(reader >> shard.depth >> shard.bits)
+            {
+                mShards.push_back(shard);
+            }
+
+            if(!reader.eof())
+            {
+                throw std::runtime_error("Corrupted manifest \"" + manifest.string() + "\"");
+            }
+        }
+        else
+        {
+            mShards.push_back(Shard{0, 0});
+
+            std::filesystem::create_directories(directory());
+
+            save();
+        }
+
+        route();
+    }
+
+                ShardedDrawer(const ShardedDrawer&) = delete;
+    ShardedDrawer& operator =(const ShardedDrawer&) = delete;
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Write a key to its shard, splitting the shard if it
+    /// grew above the threshold
+    ///
+    /// \param key Key to write
+    ///
+    ////////////////////////////////////////////////////////////
+    void        write(const Key& key)
+    {
+        Shard shard;
+
+        {
+            std::shared_lock<std::shared_mutex> lock(mMutex);
+
+            shard = locate(key.name);
+
+            mRoom.quick_write(path(shard), key, true);
+        }
+
+        grow(shard);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Apply a batch of writes and removals, each shard
+    /// modified once
+    ///
+    /// \param batch Operations to apply
+    ///
+    ////////////////////////////////////////////////////////////
+    void        apply(const WriteBatch& batch)
+    {
+        std::vector<Shard> touched;
+
+        {
+            std::shared_lock<std::shared_mutex> lock(mMutex);
+
+            std::map<std::pair<unsigned, std::uint64_t>, WriteBatch> batches;
+
+            for(const auto& it: batch.mOperations)
+            {
+                Shard shard = locate(it.first);
+
+                batches[{shard.depth, shard.bits}].set(it.first, it.second);
+            }
+
+            for(const auto& it: batches)
+            {
+                Shard shard{it.first.first, it.first.second};
+
+                mRoom.quick_apply(path(shard), it.second, true);
+
+                touched.push_back(shard);
+            }
+        }
+
+        for(const auto& it: touched)
+        {
+            grow(it);
+        }
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Read a key from its shard, served by the cache of
+    /// the room if enabled
+    ///
+    /// \param name Name of the key to read
+    ///
+    /// \return Key, without values if it doesn't exist
+    ///
+    ////////////////////////////////////////////////////////////
+    Key         read(const std::string& name)
+    {
+        std::shared_lock<std::shared_mutex> lock(mMutex);
+
+        return mRoom.quick_read(path(locate(name)), name);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Remove a key from its shard
+    ///
+    /// \param name Name of the key to delete
+    ///
+    ////////////////////////////////////////////////////////////
+    void        remove(const std::string& name)
+    {
+        std::shared_lock<std::shared_mutex> lock(mMutex);
+
+        mRoom.open(path(locate(name)), [&](Stream& stream)
+        {
+            stream.remove(name);
+        });
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Visit every key of the drawer, shard by shard, in
+    /// the order of each file
+    ///
+    /// \param visitor Function called with each key, returns
+    /// false to stop
+    ///
+    /// \return True if every key was visited
+    ///
+    ////////////////////////////////////////////////////////////
+    bool        for_each(const std::function<bool(const Key&)>& visitor)
+    {
+        std::shared_lock<std::shared_mutex> lock(mMutex);
+
+        bool visited = true;
+
+        for(std::size_t i = 0; i < mShards.size() && visited; ++i)
+        {
+            mRoom.view(path(mShards[i]), [&](const Stream& stream)
+            {
+                visited = stream.for_each(visitor);
+            });
+        }
+
+        return visited;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the number of shards
+    ///
+    /// \return Number of files holding the keys
+    ///
+    ////////////////////////////////////////////////////////////
+    std::size_t shards()
+    {
+        std::shared_lock<std::shared_mutex> lock(mMutex);
+
+        return mShards.size();
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the stable hash of the name of a key, 64 bits
+    /// FNV-1a with its bits mixed so that the low bits depend on
+    /// every bit of the name
+    ///
+    /// \param name Name of the key
+    ///
+    /// \return Hash
+    ///
+    ////////////////////////////////////////////////////////////
+    static std::uint64_t hash(std::string_view name)
+    {
+        return Codec::hash(name);
+    }
+
+private:
+    ////////////////////////////////////////////////////////////
+    /// \brief File holding the keys whose hash ends with some bits
+    ///
+    ////////////////////////////////////////////////////////////
+    struct Shard
+    {
+        unsigned        depth = 0;  ///< Number of low bits of the hash
+        std::uint64_t   bits = 0;   ///< Low bits of the hash
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the path to the directory of the shards
+    ///
+    /// \return Path to the directory, the room's base included
+    ///
+    ////////////////////////////////////////////////////////////
+    std::filesystem::path directory() const
+    {
+        std::lock_guard<std::mutex> lock(mRoom.mMutex);
+
+        return mRoom.mBase / mFile;
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Get the path to a shard in the room
+    ///
+    /// \param shard Shard
+    ///
+    /// \return Path to the file
+    ///
+    ////////////////////////////////////////////////////////////
+    std::filesystem::path path(const Shard& shard) const
+    {
+        return mFile / ("shard-" + std::to_string(shard.depth) + "-" + std::to_string(shard.bits));
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Find the shard of a key
+    ///
+    /// \param name Name of the key
+    ///
+    /// \return Shard
+    ///
+    ////////////////////////////////////////////////////////////
+    Shard       locate(std::string_view name) const
+    {
+        return mShards[mDirectory[hash(name) & (mDirectory.size() - 1)]];
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Build the directory of the shards, one entry per
+    /// value of the bits of the deepest shard
+    ///
+    ////////////////////////////////////////////////////////////
+    void        route()
+    {
+        unsigned global = 0;
+
+        for(const auto& it: mShards)
+        {
+            if(it.depth > deepest || it.bits >> it.depth != 0)
+            {
+                throw std::runtime_error("Corrupted manifest of sharded drawer \"" + mFile.string() + "\"");
+            }
+
+            global = std::max(global, it.depth);
+        }
+
+        std::vector<std::size_t> routes(std::size_t(1) << global, mShards.size());
+
+        for(std::size_t i = 0; i < mShards.size(); ++i)
+        {
+            for(std::size_t j = mShards[i].bits; j < routes.size(); j += std::size_t(1) << mShards[i].depth)
+            {
+                if(routes[j] != mShards.size())
+                {
+                    throw std::runtime_error("Corrupted manifest of sharded drawer \"" + mFile.string() + "\"");
+                }
+
+                routes[j] = i;
+            }
+        }
+
+        if(std::find(routes.begin(), routes.end(), mShards.size()) != routes.end())
+        {
+            throw std::runtime_error("Corrupted manifest of sharded drawer \"" + mFile.string() + "\"");
+        }
+
+        mDirectory = std::move(routes);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Write the list of shards to a temporary file and
+    /// rename it over the manifest
+    ///
+    ////////////////////////////////////////////////////////////
+    void        save() const
+    {
+        std::filesystem::path manifest = Stream::sidecar(directory(), ".shards");
+        std::filesystem::path temporary = Stream::sidecar(directory(), ".shards.tmp");
+
+        std::ofstream writer(temporary, std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+
+        for(const auto& it: mShards)
+        {
+            writer << it.depth << ' ' << it.bits << '\n';
+        }
+
+        writer.close();
+
+        if(!writer)
+        {
+            throw std::runtime_error("Could not write manifest on \"" + temporary.string() + "\"");
+        }
+
+        Journal::persist(temporary);
+
+        std::filesystem::rename(temporary, manifest);
+
+        Journal::persist(manifest.parent_path());
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Split a shard while it is above the threshold
+    ///
+    /// The keys are moved to two new shards, the manifest is
+    /// replaced and the old shard destroyed. Shards left by a split
+    /// that didn't finish are destroyed before being written.
+    ///
+    /// A shard holding a single key, or whose keys would all go to
+    /// the same side, is kept whole: splitting it can't make its
+    /// file smaller. It is tried again once its number of keys
+    /// changes.
+    ///
+    /// \param shard Shard written
+    ///
+    ////////////////////////////////////////////////////////////
+    void        grow(const Shard& shard)
+    {
+        std::filesystem::path shards = directory();
+
+        auto oversized = [&](const Shard& it)
+        {
+            std::error_code error;
+
+            std::uintmax_t size = std::filesystem::file_size(shards / path(it).filename(), error);
+
+            return it.depth < deepest && !error && size > mThreshold;
+        };
+
+        if(oversized(shard))
+        {
+            std::unique_lock<std::shared_mutex> lock(mMutex);
+
+            std::vector<Shard> pending{shard};
+
+            while(!pending.empty())
+            {
+                Shard split = pending.back();
+                pending.pop_back();
+
+                auto found = std::find_if(mShards.begin(), mShards.end(), [&](const Shard& it){ return it.depth == split.depth && it.bits == split.bits; });
+
+                if(found != mShards.end() && oversized(split))
+                {
+                    Shard low{split.depth + 1, split.bits};
+                    Shard high{split.depth + 1, split.bits | (std::uint64_t(1) << split.depth)};
+
+                    WriteBatch lows;
+                    WriteBatch highs;
+
+                    std::size_t keys = 0;
+
+                    mRoom.view(path(split), [&](const Stream& stream)
+                    {
+                        keys = stream.size();
+
+                        auto held = mHeld.find({split.depth, split.bits});
+
+                        if(keys > 1 && (held == mHeld.end() || held->second != keys))
+                        {
+                            stream.for_each([&](const Key& key)
+                            {
+                                ((hash(key.name) >> split.depth) & 1 ? highs : lows).write(key);
+
+                                return true;
+                            });
+                        }
+                    });
+
+                    if(lows.empty() || highs.empty())
+                    {
+                        mHeld[{split.depth, split.bits}] = keys;
+                    }
+                    else
+                    {
+                        mHeld.erase({split.depth, split.bits});
+
+                        for(const auto& it: {low, high})
+                        {
+                            if(mRoom.exists(path(it)))
+                            {
+                                mRoom.destroy(path(it));
+                            }
+                        }
+
+                        mRoom.quick_apply(path(low), lows, true);
+                        mRoom.quick_apply(path(high), highs, true);
+
+                        *found = low;
+                        mShards.push_back(high);
+
+                        route();
+                        save();
+
+                        mRoom.destroy(path(split));
+
+                        pending.push_back(low);
+                        pending.push_back(high);
+                    }
+                }
+            }
+        }
+    }
 
-private:
     ////////////////////////////////////////////////////////////
     // Member data
     ////////////////////////////////////////////////////////////
-    std::filesystem::path   mBase;  ///< Path to the base directory
+    Room&                       mRoom;      ///< Room of the drawer
+    std::filesystem::path       mFile;      ///< Path to the directory of the shards in the room
+    std::uint64_t               mThreshold; ///< Size of a shard above which it splits, in bytes
+    std::vector<Shard>          mShards;    ///< Shards, as listed in the manifest
+    std::vector<std::size_t>    mDirectory; ///< Index of the shard of each value of the low bits of the hash
+    std::map<std::pair<unsigned, std::uint64_t>, std::size_t> mHeld; ///< Number of keys of each shard kept whole because a split would leave a side empty
+    std::shared_mutex           mMutex;     ///< Shared by operations, exclusive to split a shard
 };
 
 } // namespace CNRoom